@@ -51,6 +51,54 @@ vector<NodeIter> AlignedTree::GetSplitDescendants(const NodeIter& node) const {
   return descendants;
 }
 
+vector<pair<int, int>> AlignedTree::GetLegalSpans(
+    const NodeIter& node, const NodeIter& ancestor) const {
+  pair<int, int> root_span = ancestor->GetSpan();
+  vector<bool> include(root_span.second, false);
+  vector<bool> exclude(root_span.second, false);
+
+  // Exclude indexes contained by sibling nodes.
+  vector<NodeIter> siblings = GetSplitDescendants(ancestor);
+  for (auto sibling: siblings) {
+    if (sibling != node) {
+      pair<int, int> span = sibling->GetSpan();
+      for (int j = span.first; j < span.second; ++j) {
+        exclude[j] = true;
+      }
+    }
+  }
+
+  // Include indexes contained by descendant nodes.
+  int total_includes = 0;
+  vector<NodeIter> descendants = GetSplitDescendants(node);
+  for (auto descendant: descendants) {
+    pair<int, int> span = descendant->GetSpan();
+    for (int j = span.first; j < span.second; ++j) {
+      include[j] = true;
+      ++total_includes;
+    }
+  }
+
+  // Loop over all possible span candidates. A legal span is a span that
+  // contains all includes and no excludes.
+  vector<pair<int, int>> legal_spans;
+  for (int start = root_span.first; start < root_span.second; ++start) {
+    int includes = 0;
+    for (int end = start + 1; end <= root_span.second; ++end) {
+      if (exclude[end - 1]) {
+        break;
+      }
+
+      includes += include[end - 1];
+      if (includes == total_includes) {
+        legal_spans.push_back(make_pair(start, end));
+      }
+    }
+  }
+
+  return legal_spans;
+}
+
 void AlignedTree::Write(ostream& out, Dictionary& dictionary) const {
   int var_index = 0;
   Write(out, begin(), dictionary, var_index);
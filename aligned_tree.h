@@ -4,13 +4,18 @@
 #include <fstream>
 
 #include "node.h"
+#include "node_pool_allocator.h"
 #include "tree.h"
 
 using namespace std;
 
 class Dictionary;
 
-class AlignedTree: public tree<AlignedNode> {
+// Fragments are constructed and destroyed for every sampled node, so the tree
+// nodes are allocated from per thread pools.
+typedef NodePoolAllocator<tree_node_<AlignedNode>> AlignedNodeAllocator;
+
+class AlignedTree: public tree<AlignedNode, AlignedNodeAllocator> {
  public:
   int GetRootTag() const;
 
@@ -20,6 +25,11 @@ class AlignedTree: public tree<AlignedNode> {
 
   vector<iterator> GetSplitDescendants(const iterator& root) const;
 
+  // Returns the target spans the node may be aligned to if it is split, given
+  // the spans of its split ancestor, siblings and descendants.
+  vector<pair<int, int>> GetLegalSpans(const iterator& node,
+                                       const iterator& ancestor) const;
+
   void Write(ostream& out, Dictionary& dictionary) const;
 
   bool operator<(const AlignedTree& tree) const;
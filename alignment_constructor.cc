@@ -39,26 +39,18 @@ pair<Alignment, Alignment> AlignmentConstructor::ExtractAlignments(
     }
   }
 
-  return make_pair(forward_alignment, reverse_alignment);
+  return make_pair(move(forward_alignment), move(reverse_alignment));
 }
 
 pair<Alignment, Alignment> AlignmentConstructor::ConstructAlignments(
     const Rule& rule) {
-  Alignment forward_alignment, reverse_alignment;
-
-  auto nonterminal_links = ConstructNonterminalLinks(rule);
-  copy(nonterminal_links.begin(), nonterminal_links.end(),
-       back_inserter(forward_alignment));
-  copy(nonterminal_links.begin(), nonterminal_links.end(),
-       back_inserter(reverse_alignment));
-
-  auto terminal_links = ConstructTerminalLinks(rule);
-  copy(terminal_links.first.begin(), terminal_links.first.end(),
-       back_inserter(forward_alignment));
-  copy(terminal_links.second.begin(), terminal_links.second.end(),
-       back_inserter(reverse_alignment));
-
-  return make_pair(forward_alignment, reverse_alignment);
+  Alignment nonterminal_links = ConstructNonterminalLinks(rule);
+  pair<Alignment, Alignment> alignments = ConstructTerminalLinks(rule);
+  alignments.first.insert(alignments.first.begin(),
+                          nonterminal_links.begin(), nonterminal_links.end());
+  alignments.second.insert(alignments.second.begin(),
+                           nonterminal_links.begin(), nonterminal_links.end());
+  return alignments;
 }
 
 Alignment AlignmentConstructor::ConstructNonterminalLinks(const Rule& rule) {
@@ -144,5 +136,5 @@ pair<Alignment, Alignment> AlignmentConstructor::ConstructTerminalLinks(
     ++leaf_index;
   }
 
-  return make_pair(forward_alignment, reverse_alignment);
+  return make_pair(move(forward_alignment), move(reverse_alignment));
 }
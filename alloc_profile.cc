@@ -0,0 +1,46 @@
+// Replaces the global allocation functions to count the allocations made by
+// each thread in every sampling phase. Only compiled in builds configured with
+// -DWORM_ALLOC_PROFILE=ON.
+
+#include <cstdlib>
+#include <new>
+
+#include "metrics.h"
+
+void* operator new(size_t size) {
+  Metrics::RecordAllocation(size);
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw bad_alloc();
+  }
+  return pointer;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+  Metrics::RecordAllocation(size);
+  return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+  return operator new(size, nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void* pointer, const nothrow_t&) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void* pointer, const nothrow_t&) noexcept {
+  free(pointer);
+}
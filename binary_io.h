@@ -0,0 +1,17 @@
+#pragma once
+
+#include <iostream>
+
+using namespace std;
+
+// Helpers for reading and writing plain values in binary format.
+
+template<class T>
+void WriteBinary(ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<class T>
+void ReadBinary(istream& in, T& value) {
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
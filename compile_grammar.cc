@@ -0,0 +1,77 @@
+#include <fstream>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+
+#include "dictionary.h"
+#include "grammar_compiler.h"
+#include "time_util.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+int main(int argc, char** argv) {
+  po::options_description cmdline_specific("Command line options");
+  cmdline_specific.add_options()
+      ("help,h", "Show available options")
+      ("config,c", po::value<string>(), "Path to config file");
+
+  po::options_description general_options("General options");
+  general_options.add_options()
+      ("grammar,g", po::value<string>()->required(), "Path to grammar file")
+      ("alignment,a", po::value<string>()->required(),
+          "Path to file containing rule alignments")
+      ("output,o", po::value<string>()->required(),
+          "Output file for the compiled grammar")
+      ("threshold", po::value<double>()->default_value(0)->required(),
+          "Minimum probabilty for reodering rules")
+      ("penalty", po::value<double>()->default_value(0.1)->required(),
+          "Displacement penalty for reordering")
+      ("max_leaves", po::value<int>()->default_value(5)->required(),
+          "Maximum number of leaves in rules that are reordered")
+      ("max_tree_size", po::value<int>()->default_value(8)->required(),
+          "Maximum size of a tree rule that is reordered");
+
+  po::variables_map vm;
+  po::options_description cmdline_options;
+  cmdline_options.add(cmdline_specific).add(general_options);
+  po::store(po::parse_command_line(argc, argv, cmdline_options), vm);
+
+  if (vm.count("help")) {
+    cout << cmdline_options << endl;
+    return 0;
+  }
+
+  if (vm.count("config")) {
+    po::options_description config_options;
+    config_options.add(general_options);
+    ifstream config_stream(vm["config"].as<string>());
+    po::store(po::parse_config_file(config_stream, config_options), vm);
+  }
+
+  po::notify(vm);
+
+  auto start_time = GetTime();
+  cerr << "Constructing reordering grammar..." << endl;
+  Dictionary dictionary;
+  ifstream grammar_stream(vm["grammar"].as<string>());
+  ifstream alignment_stream(vm["alignment"].as<string>());
+  GrammarCompiler compiler(
+      grammar_stream, alignment_stream, dictionary,
+      vm["penalty"].as<double>(), vm["threshold"].as<double>(),
+      vm["max_leaves"].as<int>(), vm["max_tree_size"].as<int>());
+  auto stop_time = GetTime();
+  cerr << "Constructing " << compiler.GetNumRules() << " rules took "
+       << GetDuration(start_time, stop_time) << " seconds..." << endl;
+
+  cerr << "Writing compiled grammar..." << endl;
+  ofstream out(vm["output"].as<string>(), ios::binary);
+  compiler.Write(out, dictionary);
+  if (!out) {
+    cerr << "Unable to write " << vm["output"].as<string>() << endl;
+    return 1;
+  }
+  cerr << "Done..." << endl;
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+using namespace std;
+
+// Layout of the binary reordering grammars written by compile_grammar. The
+// file starts with a CompiledGrammarHeader, followed by the sections it points
+// to. Every section starts at a multiple of 8 bytes, so the arrays can be used
+// directly from a read only memory mapping of the file. Values are stored in
+// the byte order of the machine which compiled the grammar.
+
+const char COMPILED_GRAMMAR_MAGIC[8] = {'W', 'O', 'R', 'M', 'R', 'G', '0', '1'};
+
+struct CompiledSection {
+  int64_t offset;
+  // Number of elements.
+  int64_t size;
+};
+
+struct CompiledGrammarHeader {
+  char magic[8];
+  // The options the rule reorderings were computed with.
+  double penalty;
+  double threshold;
+  int32_t max_leaves;
+  int32_t max_tree_size;
+
+  CompiledSection tags;
+  CompiledSection rules;
+  CompiledSection fragments;
+  CompiledSection fragment_nodes;
+  CompiledSection target_nodes;
+  CompiledSection trie_nodes;
+  CompiledSection trie_edges;
+  CompiledSection trie_rules;
+  // The tokens in the order of their ids, each stored as an int32_t length
+  // followed by the characters. The size is the number of tokens.
+  CompiledSection dictionary;
+};
+
+// The rules of a root tag are stored contiguously, in the order in which
+// Grammar::GetRules returns them.
+struct CompiledTag {
+  int32_t tag;
+  int32_t first_rule;
+  int32_t num_rules;
+};
+
+struct CompiledRule {
+  int32_t fragment;
+  int32_t first_target_node;
+  int32_t num_target_nodes;
+  // Written as 0, so that the files do not depend on uninitialized padding.
+  int32_t reserved;
+  double log_prob;
+};
+
+// Fragments are interned: the rules sharing a source side (with different
+// reorderings) refer to the same fragment.
+struct CompiledFragment {
+  int32_t first_node;
+  int32_t num_nodes;
+};
+
+// The nodes of a fragment are stored in preorder.
+struct CompiledNode {
+  int32_t tag;
+  int32_t word;
+  int32_t word_index;
+  int16_t num_children;
+  int16_t split_node;
+};
+
+struct CompiledStringNode {
+  int32_t word;
+  int32_t word_index;
+  int32_t var_index;
+};
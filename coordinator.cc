@@ -0,0 +1,48 @@
+#include <iostream>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+#include "count_exchange.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+int main(int argc, char** argv) {
+  po::options_description cmdline_specific("Command line options");
+  cmdline_specific.add_options()
+      ("help,h", "Show available options")
+      ("config,c", po::value<string>(), "Path to config file");
+
+  po::options_description general_options("General options");
+  general_options.add_options()
+      ("listen", po::value<string>()->required(),
+          "Address to listen on (unix:<path> or <host>:<port>)")
+      ("workers", po::value<int>()->required(),
+          "Number of sampler processes exchanging rule counts");
+
+  po::variables_map vm;
+  po::options_description cmdline_options;
+  cmdline_options.add(cmdline_specific).add(general_options);
+  po::store(po::parse_command_line(argc, argv, cmdline_options), vm);
+
+  if (vm.count("help")) {
+    cout << cmdline_options << endl;
+    return 0;
+  }
+
+  if (vm.count("config")) {
+    po::options_description config_options;
+    config_options.add(general_options);
+    ifstream config_stream(vm["config"].as<string>());
+    po::store(po::parse_config_file(config_stream, config_options), vm);
+  }
+
+  po::notify(vm);
+
+  CountExchangeServer server(vm["listen"].as<string>(), vm["workers"].as<int>());
+  server.Run();
+  cerr << "Done..." << endl;
+
+  return 0;
+}
@@ -0,0 +1,216 @@
+#include "count_exchange.h"
+
+#include <unistd.h>
+
+#include <boost/asio.hpp>
+
+#include "aligned_tree.h"
+#include "binary_io.h"
+#include "rule_count_file.h"
+#include "time_util.h"
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+using asio::local::stream_protocol;
+
+static const string UNIX_PREFIX = "unix:";
+static const int MAX_CONNECT_ATTEMPTS = 60;
+
+enum MessageType {
+  DONE = 0,
+  COUNTS = 1
+};
+
+static bool IsUnixAddress(const string& address) {
+  return address.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0;
+}
+
+static pair<string, string> SplitHostPort(const string& address) {
+  size_t separator = address.rfind(':');
+  if (separator == string::npos) {
+    cerr << "Invalid address: " << address << endl;
+    exit(1);
+  }
+  return make_pair(address.substr(0, separator),
+                   address.substr(separator + 1));
+}
+
+void WriteRuleCounts(ostream& out, const RuleCounts& counts) {
+  WriteBinary<int32_t>(out, counts.size());
+  for (const auto& entry: counts) {
+    const auto& rule_counts = entry.second.Get();
+    WriteBinary<int32_t>(out, entry.first);
+    WriteBinary<int64_t>(out, rule_counts.size());
+    for (const auto& rule_entry: rule_counts) {
+      WriteBinary<int32_t>(out, rule_entry.second);
+      WriteBinaryRule(out, rule_entry.first);
+    }
+  }
+}
+
+void ReadRuleCounts(istream& in, RuleCounts& counts, double alpha) {
+  int32_t num_restaurants;
+  ReadBinary(in, num_restaurants);
+  for (int i = 0; i < num_restaurants; ++i) {
+    int32_t root_tag;
+    int64_t num_rules;
+    ReadBinary(in, root_tag);
+    ReadBinary(in, num_rules);
+    if (!counts.count(root_tag)) {
+      counts[root_tag] = RestaurantProcess<Rule>(alpha);
+    }
+
+    auto& restaurant = counts[root_tag];
+    for (int64_t j = 0; j < num_rules; ++j) {
+      int32_t count;
+      ReadBinary(in, count);
+      restaurant.Update(ReadBinaryRule(in), count);
+    }
+  }
+}
+
+CountExchangeClient::CountExchangeClient(
+    const string& address, double alpha, Dictionary& dictionary) :
+    alpha(alpha) {
+  // The coordinator may not be listening yet.
+  for (int attempt = 0; attempt < MAX_CONNECT_ATTEMPTS; ++attempt) {
+    if (IsUnixAddress(address)) {
+      auto unix_stream = make_shared<stream_protocol::iostream>();
+      unix_stream->connect(stream_protocol::endpoint(
+          address.substr(UNIX_PREFIX.size())));
+      stream = unix_stream;
+    } else {
+      auto host_port = SplitHostPort(address);
+      stream = make_shared<tcp::iostream>(host_port.first, host_port.second);
+    }
+
+    if (*stream) {
+      break;
+    }
+    sleep(1);
+  }
+
+  if (!*stream) {
+    cerr << "Unable to connect to coordinator " << address << endl;
+    exit(1);
+  }
+  cerr << "Connected to coordinator " << address << endl;
+
+  WriteBinary<uint64_t>(*stream, GetDictionaryFingerprint(dictionary));
+  stream->flush();
+  int32_t accepted = 0;
+  ReadBinary(*stream, accepted);
+  if (!*stream || !accepted) {
+    cerr << "The dictionary differs from the dictionaries of the other "
+         << "workers, all workers must read the same training data and "
+         << "translation tables" << endl;
+    exit(1);
+  }
+}
+
+CountExchangeClient::~CountExchangeClient() {
+  WriteBinary<int32_t>(*stream, DONE);
+  stream->flush();
+}
+
+RuleCounts CountExchangeClient::Exchange(const RuleCounts& delta) {
+  WriteBinary<int32_t>(*stream, COUNTS);
+  WriteRuleCounts(*stream, delta);
+  stream->flush();
+
+  RuleCounts total_delta;
+  ReadRuleCounts(*stream, total_delta, alpha);
+  if (!*stream) {
+    cerr << "Lost connection to coordinator" << endl;
+    exit(1);
+  }
+
+  return total_delta;
+}
+
+CountExchangeServer::CountExchangeServer(
+    const string& address, int num_workers) {
+  asio::io_context io_context;
+  cerr << "Waiting for " << num_workers << " workers on " << address << endl;
+  uint64_t fingerprint = 0;
+  if (IsUnixAddress(address)) {
+    string path = address.substr(UNIX_PREFIX.size());
+    unlink(path.c_str());
+    stream_protocol::acceptor acceptor(
+        io_context, stream_protocol::endpoint(path));
+    for (int i = 0; i < num_workers; ++i) {
+      auto stream = make_shared<stream_protocol::iostream>();
+      acceptor.accept(stream->socket());
+      streams.push_back(stream);
+      CheckDictionary(i, fingerprint);
+    }
+  } else {
+    auto host_port = SplitHostPort(address);
+    tcp::acceptor acceptor(io_context, tcp::endpoint(
+        tcp::v4(), stoi(host_port.second)));
+    for (int i = 0; i < num_workers; ++i) {
+      auto stream = make_shared<tcp::iostream>();
+      acceptor.accept(stream->socket());
+      streams.push_back(stream);
+      CheckDictionary(i, fingerprint);
+    }
+  }
+  cerr << "Done..." << endl;
+}
+
+void CountExchangeServer::CheckDictionary(int worker, uint64_t& fingerprint) {
+  uint64_t worker_fingerprint;
+  ReadBinary(*streams[worker], worker_fingerprint);
+  if (worker == 0) {
+    fingerprint = worker_fingerprint;
+  }
+
+  bool accepted = *streams[worker] && worker_fingerprint == fingerprint;
+  WriteBinary<int32_t>(*streams[worker], accepted);
+  streams[worker]->flush();
+  if (!accepted) {
+    cerr << "Worker " << worker << " uses a different dictionary than "
+         << "worker 0" << endl;
+    exit(1);
+  }
+}
+
+void CountExchangeServer::Run() {
+  vector<bool> active(streams.size(), true);
+  int round = 0;
+  while (true) {
+    auto start_time = GetTime();
+    RuleCounts total_delta;
+    vector<int> round_workers;
+    for (size_t i = 0; i < streams.size(); ++i) {
+      if (!active[i]) {
+        continue;
+      }
+
+      int32_t message_type = DONE;
+      ReadBinary(*streams[i], message_type);
+      if (!*streams[i] || message_type == DONE) {
+        cerr << "Worker " << i << " is done" << endl;
+        active[i] = false;
+        continue;
+      }
+
+      ReadRuleCounts(*streams[i], total_delta, 0);
+      round_workers.push_back(i);
+    }
+
+    if (round_workers.empty()) {
+      break;
+    }
+
+    for (int worker: round_workers) {
+      WriteRuleCounts(*streams[worker], total_delta);
+      streams[worker]->flush();
+    }
+
+    auto end_time = GetTime();
+    cerr << "Round " << round++ << ": merged counts from "
+         << round_workers.size() << " workers in "
+         << GetDuration(start_time, end_time) << " seconds" << endl;
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "distributed_rule_counts.h"
+
+using namespace std;
+
+// Rule counts are shared between sampler processes (workers) through a
+// coordinator. After each iteration, every worker sends the changes to its
+// rule counts and receives the sum of the changes of all the workers.
+// Addresses are either "unix:<path>" for local sockets or "<host>:<port>".
+// The rules are exchanged as word and tag indexes, so all the workers must
+// use the same dictionary, which is checked when they connect.
+
+void WriteRuleCounts(ostream& out, const RuleCounts& counts);
+
+// Adds the counts read from the stream to the given counts.
+void ReadRuleCounts(istream& in, RuleCounts& counts, double alpha);
+
+class CountExchangeClient {
+ public:
+  // Exits if the dictionary differs from the dictionaries of the workers
+  // which connected before.
+  CountExchangeClient(const string& address, double alpha,
+                      Dictionary& dictionary);
+
+  ~CountExchangeClient();
+
+  // Sends the local changes and returns the changes of all workers.
+  RuleCounts Exchange(const RuleCounts& delta);
+
+ private:
+  shared_ptr<iostream> stream;
+  double alpha;
+};
+
+class CountExchangeServer {
+ public:
+  CountExchangeServer(const string& address, int num_workers);
+
+  // Merges the changes from the workers until all of them are done.
+  void Run();
+
+ private:
+  // Reads the dictionary fingerprint of the worker which just connected and
+  // tells it whether it matches the fingerprint of the first worker.
+  void CheckDictionary(int worker, uint64_t& fingerprint);
+
+  vector<shared_ptr<iostream>> streams;
+};
@@ -1,12 +1,28 @@
+#pragma once
+
 #include <vector>
 
+// GCC 12 reports -Wstringop-overread false positives in the move constructor
+// of small_vector, where it cannot tell that the elements of a vector using
+// its inline storage fit into it.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstringop-overread"
+#include <boost/container/small_vector.hpp>
+#pragma GCC diagnostic pop
+
 #include "node.h"
 #include "aligned_tree.h"
 
 using namespace std;
 
-typedef vector<pair<int, int>> Alignment;
-typedef vector<StringNode> String;
+// Most rule target sides and rule alignments are short, so they are stored
+// inline to avoid a heap allocation for every extracted rule.
+const size_t STRING_INLINE_SIZE = 8;
+const size_t ALIGNMENT_INLINE_SIZE = 8;
+
+typedef boost::container::small_vector<pair<int, int>, ALIGNMENT_INLINE_SIZE>
+    Alignment;
+typedef boost::container::small_vector<StringNode, STRING_INLINE_SIZE> String;
 typedef pair<AlignedTree, String> Instance;
 typedef pair<AlignedTree, String> Rule;
 typedef AlignedTree::iterator NodeIter;
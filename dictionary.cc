@@ -40,3 +40,7 @@ int Dictionary::GetIndex(const string& token) {
 string Dictionary::GetToken(int index) {
   return tokens[index];
 }
+
+int Dictionary::GetSize() const {
+  return tokens.size();
+}
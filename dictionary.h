@@ -18,6 +18,8 @@ class Dictionary {
 
   string GetToken(int index);
 
+  int GetSize() const;
+
   static const string NULL_WORD;
   static const int NULL_WORD_ID;
 
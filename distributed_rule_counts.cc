@@ -5,6 +5,8 @@
 #include <omp.h>
 
 #include "aligned_tree.h"
+#include "count_exchange.h"
+#include "memory_util.h"
 
 using namespace chrono;
 
@@ -67,7 +69,7 @@ vector<int> DistributedRuleCounts::GetNonterminals() {
 void DistributedRuleCounts::UpdateCounts(
     RuleCounts& total_counts,
     const RuleCounts& restaurant,
-    int factor) {
+    int factor) const {
   for (const auto& entry: restaurant) {
     int root_tag = entry.first;
     if (!total_counts.count(root_tag)) {
@@ -85,7 +87,7 @@ void DistributedRuleCounts::UpdateCounts(
 void DistributedRuleCounts::UpdateCounts(
     RuleCounts& total_counts,
     const vector<RuleCounts>& rule_counts,
-    int factor) {
+    int factor) const {
   for (const auto& restaurant: rule_counts) {
     UpdateCounts(total_counts, restaurant, factor);
   }
@@ -102,21 +104,83 @@ int DistributedRuleCounts::Count(int nonterminal) const {
   return rule_counts[thread_id].at(nonterminal).GetTotal();
 }
 
-void DistributedRuleCounts::Synchronize() {
-  cerr << "Synchronizing..." << endl;
-  Clock::time_point start_time = Clock::now();
+const RuleCounts& DistributedRuleCounts::GetSnapshot() const {
+  return snapshot;
+}
 
-  RuleCounts total_counts;
-  UpdateCounts(total_counts, rule_counts, 1);
-  UpdateCounts(total_counts, snapshot, -rule_counts.size());
-  UpdateCounts(snapshot, total_counts, 1);
+RuleCounts DistributedRuleCounts::CollectChanges() const {
+  RuleCounts changes;
+  UpdateCounts(changes, rule_counts, 1);
+  UpdateCounts(changes, snapshot, -rule_counts.size());
+  return changes;
+}
 
+void DistributedRuleCounts::ApplyChanges(const RuleCounts& changes) {
+  UpdateCounts(snapshot, changes, 1);
+
+  // Each replica is copied by the thread owning it, so that its memory is
+  // allocated on the NUMA node where it will be used.
+  #pragma omp parallel for schedule(static, 1) num_threads(rule_counts.size())
   for (size_t i = 0; i < rule_counts.size(); ++i) {
     rule_counts[i] = snapshot;
   }
+}
+
+void DistributedRuleCounts::Synchronize() {
+  cerr << "Synchronizing..." << endl;
+  Clock::time_point start_time = Clock::now();
+
+  ApplyChanges(CollectChanges());
 
   Clock::time_point end_time = Clock::now();
   cerr << "Synchronization took "
        << duration_cast<milliseconds>(end_time - start_time).count() / 1000.0
        << " seconds" << endl;
 }
+
+void DistributedRuleCounts::Synchronize(CountExchangeClient& exchange) {
+  cerr << "Synchronizing with other processes..." << endl;
+  Clock::time_point start_time = Clock::now();
+
+  ApplyChanges(exchange.Exchange(CollectChanges()));
+
+  Clock::time_point end_time = Clock::now();
+  cerr << "Synchronization took "
+       << duration_cast<milliseconds>(end_time - start_time).count() / 1000.0
+       << " seconds" << endl;
+}
+
+long long DistributedRuleCounts::GetReplicaMemoryUsage() const {
+  long long memory_usage = rule_counts.capacity() * sizeof(RuleCounts);
+  for (const auto& restaurants: rule_counts) {
+    memory_usage += GetMemoryUsage(restaurants);
+  }
+  return memory_usage;
+}
+
+map<int, long long> DistributedRuleCounts::GetSnapshotMemoryUsage() const {
+  map<int, long long> memory_usage;
+  for (const auto& entry: snapshot) {
+    memory_usage[entry.first] = GetMemoryUsage(entry.second);
+  }
+  return memory_usage;
+}
+
+long long DistributedRuleCounts::GetMemoryUsage(
+    const RuleCounts& restaurants) const {
+  long long memory_usage = ::GetMemoryUsage(restaurants);
+  for (const auto& entry: restaurants) {
+    memory_usage += GetMemoryUsage(entry.second);
+  }
+  return memory_usage;
+}
+
+long long DistributedRuleCounts::GetMemoryUsage(
+    const RestaurantProcess<Rule>& restaurant) const {
+  const auto& tables = restaurant.Get();
+  long long memory_usage = ::GetMemoryUsage(tables);
+  for (const auto& entry: tables) {
+    memory_usage += ::GetMemoryUsage(entry.first);
+  }
+  return memory_usage;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <memory>
 #include <unordered_map>
 
@@ -10,6 +11,8 @@ using namespace std;
 
 typedef unordered_map<int, RestaurantProcess<Rule>> RuleCounts;
 
+class CountExchangeClient;
+
 class DistributedRuleCounts {
  public:
   DistributedRuleCounts(int max_threads, double alpha);
@@ -31,18 +34,40 @@ class DistributedRuleCounts {
 
   int Count(int nonterminal) const;
 
+  // Returns the global counts as of the last call to Synchronize().
+  const RuleCounts& GetSnapshot() const;
+
   void Synchronize();
 
+  // Same as above, but the changes are also merged with the changes made by
+  // other processes since the last synchronization.
+  void Synchronize(CountExchangeClient& exchange);
+
+  // Approximate memory used by the per thread copies of the counts.
+  long long GetReplicaMemoryUsage() const;
+
+  // Approximate memory used by the snapshot, for each root tag.
+  map<int, long long> GetSnapshotMemoryUsage() const;
+
  private:
+  // Returns the changes made by all threads since the last synchronization.
+  RuleCounts CollectChanges() const;
+
+  long long GetMemoryUsage(const RuleCounts& counts) const;
+
+  long long GetMemoryUsage(const RestaurantProcess<Rule>& restaurant) const;
+
+  void ApplyChanges(const RuleCounts& changes);
+
   void AddNonterminal(vector<RuleCounts>& rule_counts, int nonterminal);
 
   void UpdateCounts(RuleCounts& total_counts,
                     const RuleCounts& rule_counts,
-                    int factor);
+                    int factor) const;
 
   void UpdateCounts(RuleCounts& total_counts,
                     const vector<RuleCounts>& rule_counts,
-                    int factor);
+                    int factor) const;
 
   vector<RuleCounts> rule_counts;
   RuleCounts snapshot;
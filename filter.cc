@@ -11,6 +11,7 @@
 #include "alignment_constructor.h"
 #include "dictionary.h"
 #include "distributed_rule_counts.h"
+#include "rule_count_file.h"
 #include "rule_extractor.h"
 #include "translation_table.h"
 #include "util.h"
@@ -27,12 +28,15 @@ int main(int argc, char** argv) {
 
   po::options_description general_options;
   general_options.add_options()
-      ("trees,t", po::value<string>()->required(),
+      ("trees,t", po::value<string>(),
           "File containing source parse trees in .ptb format")
-      ("strings,s", po::value<string>()->required(),
+      ("strings,s", po::value<string>(),
           "File containing target strings")
-      ("internal,i", po::value<string>()->required(),
+      ("internal,i", po::value<string>(),
           "File containing hidden alignment variables")
+      ("counts", po::value<string>(),
+          "Rule count file written by the sampler or by merge_counts, used "
+          "instead of the trees, strings and internal state")
       ("alpha", po::value<double>()->required(),
           "Dirichlet process concentration parameter")
       ("threshold", po::value<int>()->required(),
@@ -68,9 +72,69 @@ int main(int argc, char** argv) {
 
   po::notify(vm);
 
+  bool use_count_file = vm.count("counts");
+  if (!use_count_file &&
+      (!vm.count("trees") || !vm.count("strings") || !vm.count("internal"))) {
+    cerr << "Either --counts or --trees, --strings and --internal "
+         << "must be specified" << endl;
+    return 1;
+  }
+
+  // The dictionary of the count file must be loaded first to preserve the
+  // word ids of the rules.
   Dictionary dictionary;
+  shared_ptr<RuleCountReader> count_reader;
+  if (use_count_file) {
+    count_reader = make_shared<RuleCountReader>(
+        vm["counts"].as<string>(), dictionary);
+  }
+
   shared_ptr<TranslationTable> forward_table, reverse_table;
   LoadTranslationTables(vm, forward_table, reverse_table, dictionary);
+
+  int threshold = vm["threshold"].as<int>();
+  string output_directory = vm["output"].as<string>();
+  fs::path output_path(output_directory);
+  if (!fs::exists(output_path)) {
+    fs::create_directory(output_path);
+  }
+  if (output_directory.back() != '/') {
+    output_directory = output_directory + "/";
+  }
+
+  AlignmentConstructor alignment_constructor(forward_table, reverse_table);
+  ofstream gout(GetOutputFilename(output_directory, "grammar"));
+  ofstream fwd_out(GetOutputFilename(output_directory, "fwd"));
+  ofstream rev_out(GetOutputFilename(output_directory, "rev"));
+
+  if (use_count_file) {
+    // Stream over the count file twice: once for computing the normalization
+    // constants and once for writing the rules.
+    unordered_map<int, double> total_counts;
+    RuleCountEntry entry;
+    while (count_reader->Next(entry)) {
+      if (entry.count >= threshold) {
+        total_counts[entry.rule.first.GetRootTag()] += entry.count;
+      }
+    }
+
+    RuleCountReader rule_reader(vm["counts"].as<string>(), dictionary);
+    while (rule_reader.Next(entry)) {
+      if (entry.count >= threshold) {
+        const Rule& rule = entry.rule;
+        double rule_prob = entry.count / total_counts[rule.first.GetRootTag()];
+        WriteSTSGRule(gout, rule, dictionary);
+        gout << " ||| " << rule_prob << "\n";
+
+        auto alignments = alignment_constructor.ConstructAlignments(rule);
+        fwd_out << alignments.first << "\n";
+        rev_out << alignments.second << "\n";
+      }
+    }
+
+    return 0;
+  }
+
   vector<Instance> training = LoadInternalState(vm, dictionary);
 
   unordered_map<int, set<Rule>> rules;
@@ -89,20 +153,6 @@ int main(int argc, char** argv) {
     }
   }
 
-  int threshold = vm["threshold"].as<int>();
-  string output_directory = vm["output"].as<string>();
-  fs::path output_path(output_directory);
-  if (!fs::exists(output_path)) {
-    fs::create_directory(output_path);
-  }
-  if (output_directory.back() != '/') {
-    output_directory = output_directory + "/";
-  }
-
-  AlignmentConstructor alignment_constructor(forward_table, reverse_table);
-  ofstream gout(GetOutputFilename(output_directory, "grammar"));
-  ofstream fwd_out(GetOutputFilename(output_directory, "fwd"));
-  ofstream rev_out(GetOutputFilename(output_directory, "rev"));
   for (const auto& entry: rules) {
     double total_count = 0;
     vector<Rule> frequent_rules;
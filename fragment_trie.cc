@@ -0,0 +1,132 @@
+#include "fragment_trie.h"
+
+#include <algorithm>
+
+FragmentSymbol::FragmentSymbol() : tag(0), type(VARIABLE), value(0) {}
+
+FragmentSymbol::FragmentSymbol(int tag, Type type, int value) :
+    tag(tag), type(type), value(value) {}
+
+FragmentSymbol FragmentSymbol::FromNode(const NodeIter& node) {
+  int num_children = node.number_of_children();
+  if (num_children > 0) {
+    return FragmentSymbol(node->GetTag(), INTERIOR, num_children);
+  }
+
+  if (node->IsSetWord()) {
+    return FragmentSymbol(node->GetTag(), TERMINAL, node->GetWord());
+  }
+
+  return FragmentSymbol(node->GetTag(), VARIABLE, 0);
+}
+
+bool FragmentSymbol::operator<(const FragmentSymbol& other) const {
+  if (tag != other.tag) {
+    return tag < other.tag;
+  }
+  if (type != other.type) {
+    return type < other.type;
+  }
+  return value < other.value;
+}
+
+bool FragmentSymbol::operator==(const FragmentSymbol& other) const {
+  return tag == other.tag && type == other.type && value == other.value;
+}
+
+FragmentTrie::FragmentTrie() :
+    nodes(nullptr), edges(nullptr), rule_indexes(nullptr) {}
+
+FragmentTrie::FragmentTrie(
+    const FragmentTrieNode* nodes, const FragmentTrieEdge* edges,
+    const int32_t* rule_indexes) :
+    nodes(nodes), edges(edges), rule_indexes(rule_indexes) {}
+
+int FragmentTrie::FindChild(int trie_node,
+                            const FragmentSymbol& symbol) const {
+  const FragmentTrieEdge* first = edges + nodes[trie_node].first_edge;
+  const FragmentTrieEdge* last = first + nodes[trie_node].num_edges;
+  auto it = lower_bound(first, last, symbol,
+      [](const FragmentTrieEdge& edge, const FragmentSymbol& symbol) {
+        return edge.symbol < symbol;
+      });
+  if (it == last || !(it->symbol == symbol)) {
+    return -1;
+  }
+  return it->child;
+}
+
+void FragmentTrie::Match(const IndexedTree& tree, int tree_node,
+                         vector<FragmentMatch>& matches,
+                         vector<int>& frontier_pool) const {
+  vector<int> pending(1, tree_node), frontier;
+  size_t old_size = matches.size();
+  Match(tree, 0, pending, frontier, matches, frontier_pool);
+  sort(matches.begin() + old_size, matches.end(),
+       [](const FragmentMatch& a, const FragmentMatch& b) {
+         return a.rule_index < b.rule_index;
+       });
+}
+
+// The pending stack holds the tree nodes which have yet to be matched, the
+// next node in preorder on top. A fragment matches when its last symbol is
+// consumed, which is exactly when the stack becomes empty.
+void FragmentTrie::Match(const IndexedTree& tree, int trie_node,
+                         vector<int>& pending, vector<int>& frontier,
+                         vector<FragmentMatch>& matches,
+                         vector<int>& frontier_pool) const {
+  if (pending.empty()) {
+    const FragmentTrieNode& node = nodes[trie_node];
+    if (node.num_rules == 0) {
+      return;
+    }
+
+    FragmentMatch match;
+    match.first_frontier = frontier_pool.size();
+    match.num_frontier = frontier.size();
+    frontier_pool.insert(frontier_pool.end(), frontier.begin(), frontier.end());
+    for (int i = node.first_rule; i < node.first_rule + node.num_rules; ++i) {
+      match.rule_index = rule_indexes[i];
+      matches.push_back(match);
+    }
+    return;
+  }
+
+  int tree_node = pending.back();
+  pending.pop_back();
+  int tag = tree.GetTag(tree_node);
+
+  int child = FindChild(trie_node,
+                        FragmentSymbol(tag, FragmentSymbol::VARIABLE, 0));
+  if (child != -1) {
+    frontier.push_back(tree_node);
+    Match(tree, child, pending, frontier, matches, frontier_pool);
+    frontier.pop_back();
+  }
+
+  if (tree.IsSetWord(tree_node)) {
+    child = FindChild(trie_node, FragmentSymbol(
+        tag, FragmentSymbol::TERMINAL, tree.GetWord(tree_node)));
+    if (child != -1) {
+      Match(tree, child, pending, frontier, matches, frontier_pool);
+    }
+  }
+
+  int num_children = tree.GetNumChildren(tree_node);
+  if (num_children > 0) {
+    child = FindChild(trie_node, FragmentSymbol(
+        tag, FragmentSymbol::INTERIOR, num_children));
+    if (child != -1) {
+      size_t old_size = pending.size();
+      int end = tree.GetSubtreeEnd(tree_node);
+      for (int it = tree_node + 1; it != end; it = tree.GetSubtreeEnd(it)) {
+        pending.push_back(it);
+      }
+      reverse(pending.begin() + old_size, pending.end());
+      Match(tree, child, pending, frontier, matches, frontier_pool);
+      pending.resize(old_size);
+    }
+  }
+
+  pending.push_back(tree_node);
+}
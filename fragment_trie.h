@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "aligned_tree.h"
+#include "definitions.h"
+#include "indexed_tree.h"
+
+using namespace std;
+
+// A node of a grammar fragment as seen in a preorder traversal: a nonterminal
+// with a given number of children, a terminal or a frontier nonterminal.
+struct FragmentSymbol {
+  enum Type {
+    VARIABLE,
+    TERMINAL,
+    INTERIOR
+  };
+
+  FragmentSymbol();
+
+  FragmentSymbol(int tag, Type type, int value);
+
+  static FragmentSymbol FromNode(const NodeIter& node);
+
+  bool operator<(const FragmentSymbol& other) const;
+
+  bool operator==(const FragmentSymbol& other) const;
+
+  int32_t tag;
+  int32_t type;
+  // The word of terminals and the number of children of interior nodes.
+  int32_t value;
+};
+
+// The trie is stored in flat arrays, such that it can be used directly from a
+// compiled grammar file. The edges leaving a node are contiguous and sorted by
+// symbol.
+struct FragmentTrieNode {
+  int32_t first_edge;
+  int32_t num_edges;
+  int32_t first_rule;
+  int32_t num_rules;
+};
+
+struct FragmentTrieEdge {
+  FragmentSymbol symbol;
+  int32_t child;
+};
+
+// One match of a fragment against a tree node: the index of the rule in the
+// list of rules for the root tag and the span of a frontier pool holding the
+// ids of the tree nodes matched by the frontier nonterminals of the fragment,
+// from left to right.
+struct FragmentMatch {
+  int32_t rule_index;
+  int32_t first_frontier;
+  int32_t num_frontier;
+};
+
+// Prefix tree over the preorder traversals of the grammar fragments. Fragments
+// sharing a top part share a path in the trie, so all the fragments matching a
+// tree node are found with a single walk of the trie, instead of matching every
+// rule separately. The trie does not own its arrays and is read only, so it can
+// be shared by any number of threads.
+class FragmentTrie {
+ public:
+  FragmentTrie();
+
+  FragmentTrie(const FragmentTrieNode* nodes, const FragmentTrieEdge* edges,
+               const int32_t* rule_indexes);
+
+  // Appends the matches against the tree node to matches, sorted by rule
+  // index, and their frontier nodes to frontier_pool. Matches found at the
+  // same trie node share their frontier span.
+  void Match(const IndexedTree& tree, int tree_node,
+             vector<FragmentMatch>& matches, vector<int>& frontier_pool) const;
+
+ private:
+  int FindChild(int trie_node, const FragmentSymbol& symbol) const;
+
+  void Match(const IndexedTree& tree, int trie_node, vector<int>& pending,
+             vector<int>& frontier, vector<FragmentMatch>& matches,
+             vector<int>& frontier_pool) const;
+
+  const FragmentTrieNode* nodes;
+  const FragmentTrieEdge* edges;
+  const int32_t* rule_indexes;
+};
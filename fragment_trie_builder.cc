@@ -0,0 +1,53 @@
+#include "fragment_trie_builder.h"
+
+#include <algorithm>
+
+FragmentTrieBuilder::FragmentTrieBuilder() : nodes(1) {}
+
+void FragmentTrieBuilder::Insert(const AlignedTree& fragment, int rule_index) {
+  int trie_node = 0;
+  for (auto node = fragment.begin(); node != fragment.end(); ++node) {
+    trie_node = FindOrAddChild(trie_node, FragmentSymbol::FromNode(node));
+  }
+  nodes[trie_node].rule_indexes.push_back(rule_index);
+}
+
+int FragmentTrieBuilder::FindOrAddChild(int node,
+                                        const FragmentSymbol& symbol) {
+  auto& children = nodes[node].children;
+  auto it = lower_bound(children.begin(), children.end(),
+                        make_pair(symbol, 0));
+  if (it != children.end() && it->first == symbol) {
+    return it->second;
+  }
+
+  int child = nodes.size();
+  children.insert(it, make_pair(symbol, child));
+  nodes.push_back(Node());
+  return child;
+}
+
+void FragmentTrieBuilder::Build(vector<FragmentTrieNode>& trie_nodes,
+                                vector<FragmentTrieEdge>& trie_edges,
+                                vector<int32_t>& rule_indexes) const {
+  trie_nodes.clear();
+  trie_edges.clear();
+  rule_indexes.clear();
+  for (const Node& node: nodes) {
+    FragmentTrieNode trie_node;
+    trie_node.first_edge = trie_edges.size();
+    trie_node.num_edges = node.children.size();
+    trie_node.first_rule = rule_indexes.size();
+    trie_node.num_rules = node.rule_indexes.size();
+    trie_nodes.push_back(trie_node);
+
+    for (const auto& child: node.children) {
+      FragmentTrieEdge edge;
+      edge.symbol = child.first;
+      edge.child = child.second;
+      trie_edges.push_back(edge);
+    }
+    rule_indexes.insert(rule_indexes.end(), node.rule_indexes.begin(),
+                        node.rule_indexes.end());
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include "fragment_trie.h"
+
+using namespace std;
+
+// Constructs the flat arrays of a FragmentTrie from the grammar fragments.
+class FragmentTrieBuilder {
+ public:
+  FragmentTrieBuilder();
+
+  void Insert(const AlignedTree& fragment, int rule_index);
+
+  // The root of the trie is the first node.
+  void Build(vector<FragmentTrieNode>& trie_nodes,
+             vector<FragmentTrieEdge>& trie_edges,
+             vector<int32_t>& rule_indexes) const;
+
+ private:
+  struct Node {
+    // Sorted by symbol.
+    vector<pair<FragmentSymbol, int>> children;
+    vector<int> rule_indexes;
+  };
+
+  int FindOrAddChild(int node, const FragmentSymbol& symbol);
+
+  vector<Node> nodes;
+};
@@ -1,3 +1,5 @@
+#include <iostream>
+
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
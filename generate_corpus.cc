@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "synthetic_corpus.h"
+#include "time_util.h"
+
+using namespace std;
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+int main(int argc, char** argv) {
+  po::options_description cmdline_specific("Command line options");
+  cmdline_specific.add_options()
+      ("help,h", "Show available options")
+      ("config,c", po::value<string>(), "Path to config file");
+
+  po::options_description general_options("General options");
+  general_options.add_options()
+      ("sentences,n", po::value<int>()->default_value(1000),
+          "Number of sentence pairs")
+      ("length-mean", po::value<double>()->default_value(20),
+          "Mean of the normal distribution of the source sentence lengths")
+      ("length-stddev", po::value<double>()->default_value(10),
+          "Standard deviation of the source sentence lengths")
+      ("max-length", po::value<int>()->default_value(80),
+          "Maximum source sentence length")
+      ("tags", po::value<int>()->default_value(30),
+          "Number of distinct nonterminals and preterminals")
+      ("vocabulary", po::value<int>()->default_value(50000),
+          "Number of distinct words in each language")
+      ("max-depth", po::value<int>()->default_value(15),
+          "Maximum depth of the parse trees")
+      ("swap-prob", po::value<double>()->default_value(0.3),
+          "Probability of reversing the children of a constituent on the "
+          "target side")
+      ("null-prob", po::value<double>()->default_value(0.1),
+          "Probability of an unaligned word on either side")
+      ("seed", po::value<unsigned int>()->default_value(0),
+          "Seed for random generator")
+      ("output,o", po::value<string>()->required(), "Output directory");
+
+  po::variables_map vm;
+  po::options_description cmdline_options;
+  cmdline_options.add(cmdline_specific).add(general_options);
+  po::store(po::parse_command_line(argc, argv, cmdline_options), vm);
+
+  if (vm.count("help")) {
+    cout << cmdline_options << endl;
+    return 0;
+  }
+
+  if (vm.count("config")) {
+    po::options_description config_options;
+    config_options.add(general_options);
+    ifstream config_stream(vm["config"].as<string>());
+    po::store(po::parse_config_file(config_stream, config_options), vm);
+  }
+
+  po::notify(vm);
+
+  fs::path output_path(vm["output"].as<string>());
+  if (!fs::exists(output_path)) {
+    fs::create_directories(output_path);
+  }
+
+  auto start_time = GetTime();
+  unsigned int seed = vm["seed"].as<unsigned int>();
+  SyntheticCorpus corpus(vm["tags"].as<int>(), vm["vocabulary"].as<int>(),
+                         vm["max-depth"].as<int>(),
+                         vm["swap-prob"].as<double>(),
+                         vm["null-prob"].as<double>(), seed);
+
+  cerr << "Writing translation tables..." << endl;
+  ofstream forward_stream((output_path / "fwd.probs").string());
+  corpus.WriteTranslationTable(forward_stream, false);
+  ofstream reverse_stream((output_path / "rev.probs").string());
+  corpus.WriteTranslationTable(reverse_stream, true);
+
+  cerr << "Writing sentences..." << endl;
+  ofstream tree_stream((output_path / "corpus.trees").string());
+  ofstream source_stream((output_path / "corpus.source").string());
+  ofstream target_stream((output_path / "corpus.target").string());
+  ofstream alignment_stream((output_path / "corpus.align").string());
+
+  // The sentence lengths are drawn independently of the sentences such that
+  // changing the length distribution does not change the other choices.
+  mt19937 length_generator(seed + 1);
+  normal_distribution<double> length_distribution(
+      vm["length-mean"].as<double>(), vm["length-stddev"].as<double>());
+  int max_length = vm["max-length"].as<int>();
+  int num_sentences = vm["sentences"].as<int>();
+  for (int i = 0; i < num_sentences; ++i) {
+    int length = round(length_distribution(length_generator));
+    length = max(1, min(length, max_length));
+    SyntheticSentence sentence = corpus.GenerateSentence(length);
+    tree_stream << sentence.tree << "\n";
+    source_stream << sentence.source_string << "\n";
+    target_stream << sentence.target_string << "\n";
+    alignment_stream << sentence.alignment << "\n";
+
+    if ((i + 1) % 100000 == 0) {
+      cerr << "Generated " << i + 1 << " sentences..." << endl;
+    }
+  }
+
+  auto end_time = GetTime();
+  cerr << "Generated " << num_sentences << " sentences in "
+       << GetDuration(start_time, end_time) << " seconds..." << endl;
+
+  return 0;
+}
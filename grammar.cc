@@ -1,72 +1,190 @@
 #include "grammar.h"
 
-#include <string>
-#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include <boost/regex.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stack>
 
 #include "dictionary.h"
+#include "grammar_compiler.h"
 
 Grammar::Grammar(ifstream& grammar_stream, ifstream& alignment_stream,
                  Dictionary& dictionary, double penalty, double threshold,
                  int max_leaves, int max_tree_size) :
-    rule_reorderer(penalty, max_leaves, max_tree_size) {
-  map<Rule, double> reordering_probs;
-  while (!grammar_stream.eof()) {
-    pair<Rule, double> entry = ReadRule(grammar_stream, dictionary);
-    Alignment alignment;
-    alignment_stream >> alignment;
-
-    const Rule& rule = entry.first;
-    RemoveMixedLinks(rule, alignment);
-
-    double prob = entry.second;
-    const AlignedTree& tree = rule.first;
-    String reordering = rule_reorderer.Reorder(tree, alignment);
-    reordering_probs[make_pair(tree, reordering)] += prob;
-
-    grammar_stream >> ws;
+    mapping(nullptr) {
+  GrammarCompiler compiler(grammar_stream, alignment_stream, dictionary,
+                           penalty, threshold, max_leaves, max_tree_size);
+  ostringstream out;
+  compiler.Write(out, dictionary);
+  buffer = out.str();
+  data = buffer.data();
+  size = buffer.size();
+  Load("compiled grammar", dictionary);
+}
+
+Grammar::Grammar(const string& filename, Dictionary& dictionary) :
+    mapping(nullptr) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0) {
+    cerr << "Unable to open " << filename << endl;
+    exit(1);
   }
 
-  for (auto rule: reordering_probs) {
-    if (rule.second >= threshold) {
-      rules[rule.first.first.GetRootTag()].push_back(
-          make_pair(rule.first, log(rule.second)));
-    }
+  size = file_stat.st_size;
+  if (size > 0) {
+    mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
   }
+  close(fd);
+  if (mapping == nullptr || mapping == MAP_FAILED) {
+    cerr << "Unable to map " << filename << " in memory" << endl;
+    exit(1);
+  }
+
+  data = static_cast<const char*>(mapping);
+  Load(filename, dictionary);
 }
 
+Grammar::~Grammar() {
+  if (mapping != nullptr) {
+    munmap(mapping, size);
+  }
+}
 
-void Grammar::RemoveMixedLinks(const Rule& rule, Alignment& alignment) {
-  const AlignedTree& tree = rule.first;
-  unordered_set<int> source_var_indexes;
-  int leaf_index = 0;
-  for (auto leaf = tree.begin_leaf(); leaf != tree.end_leaf(); ++leaf) {
-    if (leaf->IsSplitNode()) {
-      source_var_indexes.insert(leaf_index);
-    }
-    ++leaf_index;
+template<class T>
+const T* Grammar::GetSection(
+    const string& name, const CompiledSection& section) const {
+  if (section.offset < 0 || section.size < 0 || section.offset % 8 != 0 ||
+      (uint64_t) section.offset + section.size * sizeof(T) > size) {
+    cerr << name << " is truncated or corrupted" << endl;
+    exit(1);
   }
+  return reinterpret_cast<const T*>(data + section.offset);
+}
 
-  const String& target_string = rule.second;
-  unordered_set<int> target_var_indexes;
-  for (size_t i = 0; i < target_string.size(); ++i) {
-    if (!target_string[i].IsSetWord()) {
-      target_var_indexes.insert(i);
+void Grammar::Load(const string& name, Dictionary& dictionary) {
+  header = reinterpret_cast<const CompiledGrammarHeader*>(data);
+  if (size < sizeof(CompiledGrammarHeader) ||
+      memcmp(header->magic, COMPILED_GRAMMAR_MAGIC, sizeof(header->magic))) {
+    cerr << name << " is not a compiled grammar" << endl;
+    exit(1);
+  }
+
+  tags = GetSection<CompiledTag>(name, header->tags);
+  compiled_rules = GetSection<CompiledRule>(name, header->rules);
+  fragments = GetSection<CompiledFragment>(name, header->fragments);
+  fragment_nodes = GetSection<CompiledNode>(name, header->fragment_nodes);
+  target_nodes = GetSection<CompiledStringNode>(name, header->target_nodes);
+  fragment_trie = FragmentTrie(
+      GetSection<FragmentTrieNode>(name, header->trie_nodes),
+      GetSection<FragmentTrieEdge>(name, header->trie_edges),
+      GetSection<int32_t>(name, header->trie_rules));
+
+  const char* token_data = GetSection<char>(name, header->dictionary);
+  const char* end = data + size;
+  for (int i = 0; i < header->dictionary.size; ++i) {
+    int32_t length;
+    if (token_data + sizeof(length) > end) {
+      cerr << name << " is truncated or corrupted" << endl;
+      exit(1);
+    }
+    memcpy(&length, token_data, sizeof(length));
+    token_data += sizeof(length);
+    if (length < 0 || token_data + length > end) {
+      cerr << name << " is truncated or corrupted" << endl;
+      exit(1);
     }
+
+    if (dictionary.GetIndex(string(token_data, length)) != i) {
+      cerr << "The dictionary of " << name << " does not match" << endl;
+      exit(1);
+    }
+    token_data += length;
   }
 
-  alignment.erase(remove_if(alignment.begin(), alignment.end(),
-      [&source_var_indexes, &target_var_indexes](const pair<int, int>& link) {
-        return source_var_indexes.count(link.first) ^
-               target_var_indexes.count(link.second);
-      }), alignment.end());
+  for (int i = 0; i < header->tags.size; ++i) {
+    tag_indexes[tags[i].tag] = i;
+  }
+  rules.resize(header->tags.size);
+  rules_constructed.reset(new once_flag[header->tags.size]);
 }
 
 bool Grammar::HasRules(int root_tag) const {
-  return rules.count(root_tag);
+  return tag_indexes.count(root_tag);
 }
 
 const vector<pair<Rule, double>>& Grammar::GetRules(int root_tag) const {
-  return rules.at(root_tag);
+  int tag_index = tag_indexes.at(root_tag);
+  call_once(rules_constructed[tag_index],
+            &Grammar::ConstructRules, this, tag_index);
+  return rules[tag_index];
+}
+
+const FragmentTrie& Grammar::GetFragmentTrie() const {
+  return fragment_trie;
+}
+
+const CompiledGrammarHeader& Grammar::GetHeader() const {
+  return *header;
+}
+
+void Grammar::ConstructRules(int tag_index) const {
+  const CompiledTag& tag = tags[tag_index];
+  vector<pair<Rule, double>>& tag_rules = rules[tag_index];
+  tag_rules.reserve(tag.num_rules);
+  for (int i = tag.first_rule; i < tag.first_rule + tag.num_rules; ++i) {
+    const CompiledRule& compiled_rule = compiled_rules[i];
+    String target_string;
+    for (int j = 0; j < compiled_rule.num_target_nodes; ++j) {
+      const CompiledStringNode& node =
+          target_nodes[compiled_rule.first_target_node + j];
+      target_string.push_back(
+          StringNode(node.word, node.word_index, node.var_index));
+    }
+
+    tag_rules.push_back(make_pair(
+        Rule(ConstructFragment(compiled_rule.fragment), move(target_string)),
+        compiled_rule.log_prob));
+  }
+}
+
+AlignedTree Grammar::ConstructFragment(int fragment) const {
+  const CompiledFragment& compiled_fragment = fragments[fragment];
+  AlignedTree tree;
+  // The nodes which still miss some of their children, with the number of
+  // missing children.
+  stack<pair<AlignedTree::iterator, int>> st;
+  for (int i = 0; i < compiled_fragment.num_nodes; ++i) {
+    const CompiledNode& compiled_node =
+        fragment_nodes[compiled_fragment.first_node + i];
+    AlignedNode node;
+    node.SetTag(compiled_node.tag);
+    if (compiled_node.word >= 0) {
+      node.SetWord(compiled_node.word);
+      node.SetWordIndex(compiled_node.word_index);
+    }
+    node.SetSplitNode(compiled_node.split_node);
+
+    AlignedTree::iterator it;
+    if (st.empty()) {
+      it = tree.insert(tree.begin(), node);
+    } else {
+      it = tree.append_child(st.top().first, node);
+      if (--st.top().second == 0) {
+        st.pop();
+      }
+    }
+
+    if (compiled_node.num_children > 0) {
+      st.push(make_pair(it, (int) compiled_node.num_children));
+    }
+  }
+
+  return tree;
 }
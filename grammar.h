@@ -2,41 +2,77 @@
 #define _GRAMMAR_H_
 
 #include <fstream>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "aligned_tree.h"
-#include "rule_reorderer.h"
+#include "compiled_grammar.h"
+#include "fragment_trie.h"
 #include "util.h"
 
 using namespace std;
 
 class Dictionary;
 
+// Reordering grammar in the format written by compile_grammar. The fragment
+// trie is used in place, while the rules of a root tag are only constructed
+// the first time they are requested.
 class Grammar {
  public:
+  // Compiles the text grammar in memory.
   Grammar(ifstream& grammar_stream, ifstream& alignment_stream,
           Dictionary& dictionary, double penalty, double threshold,
           int max_leaves, int max_tree_size);
 
+  // Maps a compiled grammar file in memory, so that the pages are shared by
+  // all the processes using the same grammar. The tokens of the grammar are
+  // added to the dictionary, which must be either empty or identical to the
+  // dictionary of the grammar.
+  Grammar(const string& filename, Dictionary& dictionary);
+
+  ~Grammar();
+
   bool HasRules(int tag) const;
 
+  // Safe to call from multiple threads.
   const vector<pair<Rule, double>>& GetRules(int tag) const;
 
+  // The fragments of all the rules, indexed by their position in GetRules.
+  const FragmentTrie& GetFragmentTrie() const;
+
+  const CompiledGrammarHeader& GetHeader() const;
+
  private:
-  // Removes nonterminal-terminal and terminal-nonterminal links from the
-  // alignment. These links may appear due to symmetrization.
-  void RemoveMixedLinks(const Rule& rule, Alignment& alignment);
+  void Load(const string& name, Dictionary& dictionary);
+
+  template<class T>
+  const T* GetSection(const string& name,
+                      const CompiledSection& section) const;
+
+  void ConstructRules(int tag_index) const;
+
+  AlignedTree ConstructFragment(int fragment) const;
 
-  String FindBestReordering(const AlignedTree& tree,
-                            const Alignment& alignment);
+  // Owns the grammar compiled in memory.
+  string buffer;
+  void* mapping;
+  size_t size;
+  const char* data;
 
-  String ConstructRuleReordering(const vector<NodeIter>& source_items,
-                                 const vector<int>& permutation);
+  const CompiledGrammarHeader* header;
+  const CompiledTag* tags;
+  const CompiledRule* compiled_rules;
+  const CompiledFragment* fragments;
+  const CompiledNode* fragment_nodes;
+  const CompiledStringNode* target_nodes;
+  FragmentTrie fragment_trie;
 
-  RuleReorderer rule_reorderer;
-  unordered_map<int, vector<pair<Rule, double>>> rules;
+  unordered_map<int, int> tag_indexes;
+  mutable vector<vector<pair<Rule, double>>> rules;
+  unique_ptr<once_flag[]> rules_constructed;
 };
 
 #endif
@@ -0,0 +1,214 @@
+#include "grammar_compiler.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+
+#include "binary_io.h"
+#include "compiled_grammar.h"
+#include "dictionary.h"
+#include "fragment_trie_builder.h"
+#include "util.h"
+
+GrammarCompiler::GrammarCompiler(
+    ifstream& grammar_stream, ifstream& alignment_stream,
+    Dictionary& dictionary, double penalty, double threshold,
+    int max_leaves, int max_tree_size) :
+    penalty(penalty), threshold(threshold), max_leaves(max_leaves),
+    max_tree_size(max_tree_size),
+    rule_reorderer(penalty, max_leaves, max_tree_size) {
+  map<Rule, double> reordering_probs;
+  while (!grammar_stream.eof()) {
+    pair<Rule, double> entry = ReadRule(grammar_stream, dictionary);
+    Alignment alignment;
+    alignment_stream >> alignment;
+
+    const Rule& rule = entry.first;
+    RemoveMixedLinks(rule, alignment);
+
+    double prob = entry.second;
+    const AlignedTree& tree = rule.first;
+    String reordering = rule_reorderer.Reorder(tree, alignment);
+    reordering_probs[make_pair(tree, reordering)] += prob;
+
+    grammar_stream >> ws;
+  }
+
+  for (auto rule: reordering_probs) {
+    if (rule.second >= threshold) {
+      rules[rule.first.first.GetRootTag()].push_back(
+          make_pair(rule.first, log(rule.second)));
+    }
+  }
+}
+
+void GrammarCompiler::RemoveMixedLinks(
+    const Rule& rule, Alignment& alignment) {
+  const AlignedTree& tree = rule.first;
+  unordered_set<int> source_var_indexes;
+  int leaf_index = 0;
+  for (auto leaf = tree.begin_leaf(); leaf != tree.end_leaf(); ++leaf) {
+    if (leaf->IsSplitNode()) {
+      source_var_indexes.insert(leaf_index);
+    }
+    ++leaf_index;
+  }
+
+  const String& target_string = rule.second;
+  unordered_set<int> target_var_indexes;
+  for (size_t i = 0; i < target_string.size(); ++i) {
+    if (!target_string[i].IsSetWord()) {
+      target_var_indexes.insert(i);
+    }
+  }
+
+  alignment.erase(remove_if(alignment.begin(), alignment.end(),
+      [&source_var_indexes, &target_var_indexes](const pair<int, int>& link) {
+        return source_var_indexes.count(link.first) ^
+               target_var_indexes.count(link.second);
+      }), alignment.end());
+}
+
+int GrammarCompiler::GetNumRules() const {
+  int num_rules = 0;
+  for (const auto& entry: rules) {
+    num_rules += entry.second.size();
+  }
+  return num_rules;
+}
+
+static int64_t AlignOffset(int64_t offset) {
+  return (offset + 7) / 8 * 8;
+}
+
+// Assigns the next offset in the file to the section.
+static void PlaceSection(CompiledSection& section, int64_t size,
+                         int64_t bytes, int64_t& offset) {
+  offset = AlignOffset(offset);
+  section.offset = offset;
+  section.size = size;
+  offset += bytes;
+}
+
+template<class T>
+static void PlaceSection(CompiledSection& section, const vector<T>& values,
+                         int64_t& offset) {
+  PlaceSection(section, values.size(), values.size() * sizeof(T), offset);
+}
+
+template<class T>
+static void WriteSection(ostream& out, const CompiledSection& section,
+                         const vector<T>& values, int64_t& offset) {
+  while (offset < section.offset) {
+    out.put(0);
+    ++offset;
+  }
+  out.write(reinterpret_cast<const char*>(values.data()),
+            values.size() * sizeof(T));
+  offset += values.size() * sizeof(T);
+}
+
+void GrammarCompiler::Write(ostream& out, Dictionary& dictionary) const {
+  vector<CompiledTag> tags;
+  vector<CompiledRule> compiled_rules;
+  vector<CompiledFragment> fragments;
+  vector<CompiledNode> fragment_nodes;
+  vector<CompiledStringNode> target_nodes;
+  map<AlignedTree, int> fragment_ids;
+  FragmentTrieBuilder trie_builder;
+  for (const auto& entry: rules) {
+    CompiledTag tag;
+    tag.tag = entry.first;
+    tag.first_rule = compiled_rules.size();
+    tag.num_rules = entry.second.size();
+    tags.push_back(tag);
+
+    for (size_t i = 0; i < entry.second.size(); ++i) {
+      const Rule& rule = entry.second[i].first;
+      const AlignedTree& fragment = rule.first;
+      trie_builder.Insert(fragment, i);
+
+      auto result = fragment_ids.insert(make_pair(fragment, fragments.size()));
+      if (result.second) {
+        CompiledFragment compiled_fragment;
+        compiled_fragment.first_node = fragment_nodes.size();
+        compiled_fragment.num_nodes = fragment.size();
+        fragments.push_back(compiled_fragment);
+        for (auto node = fragment.begin(); node != fragment.end(); ++node) {
+          CompiledNode compiled_node;
+          compiled_node.tag = node->GetTag();
+          compiled_node.word = node->GetWord();
+          compiled_node.word_index = node->GetWordIndex();
+          compiled_node.num_children = node.number_of_children();
+          compiled_node.split_node = node->IsSplitNode();
+          fragment_nodes.push_back(compiled_node);
+        }
+      }
+
+      CompiledRule compiled_rule;
+      compiled_rule.fragment = result.first->second;
+      compiled_rule.first_target_node = target_nodes.size();
+      compiled_rule.num_target_nodes = rule.second.size();
+      compiled_rule.reserved = 0;
+      compiled_rule.log_prob = entry.second[i].second;
+      compiled_rules.push_back(compiled_rule);
+      for (const auto& node: rule.second) {
+        CompiledStringNode compiled_node;
+        compiled_node.word = node.GetWord();
+        compiled_node.word_index = node.GetWordIndex();
+        compiled_node.var_index = node.GetVarIndex();
+        target_nodes.push_back(compiled_node);
+      }
+    }
+  }
+
+  vector<FragmentTrieNode> trie_nodes;
+  vector<FragmentTrieEdge> trie_edges;
+  vector<int32_t> trie_rules;
+  trie_builder.Build(trie_nodes, trie_edges, trie_rules);
+
+  vector<char> dictionary_bytes;
+  for (int i = 0; i < dictionary.GetSize(); ++i) {
+    string token = dictionary.GetToken(i);
+    int32_t length = token.size();
+    const char* length_bytes = reinterpret_cast<const char*>(&length);
+    dictionary_bytes.insert(dictionary_bytes.end(), length_bytes,
+                            length_bytes + sizeof(length));
+    dictionary_bytes.insert(dictionary_bytes.end(), token.begin(),
+                            token.end());
+  }
+
+  CompiledGrammarHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, COMPILED_GRAMMAR_MAGIC, sizeof(header.magic));
+  header.penalty = penalty;
+  header.threshold = threshold;
+  header.max_leaves = max_leaves;
+  header.max_tree_size = max_tree_size;
+
+  int64_t offset = sizeof(header);
+  PlaceSection(header.tags, tags, offset);
+  PlaceSection(header.rules, compiled_rules, offset);
+  PlaceSection(header.fragments, fragments, offset);
+  PlaceSection(header.fragment_nodes, fragment_nodes, offset);
+  PlaceSection(header.target_nodes, target_nodes, offset);
+  PlaceSection(header.trie_nodes, trie_nodes, offset);
+  PlaceSection(header.trie_edges, trie_edges, offset);
+  PlaceSection(header.trie_rules, trie_rules, offset);
+  PlaceSection(header.dictionary, dictionary.GetSize(),
+               dictionary_bytes.size(), offset);
+
+  WriteBinary(out, header);
+  offset = sizeof(header);
+  WriteSection(out, header.tags, tags, offset);
+  WriteSection(out, header.rules, compiled_rules, offset);
+  WriteSection(out, header.fragments, fragments, offset);
+  WriteSection(out, header.fragment_nodes, fragment_nodes, offset);
+  WriteSection(out, header.target_nodes, target_nodes, offset);
+  WriteSection(out, header.trie_nodes, trie_nodes, offset);
+  WriteSection(out, header.trie_edges, trie_edges, offset);
+  WriteSection(out, header.trie_rules, trie_rules, offset);
+  WriteSection(out, header.dictionary, dictionary_bytes, offset);
+}
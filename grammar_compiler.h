@@ -0,0 +1,38 @@
+#pragma once
+
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "definitions.h"
+#include "rule_reorderer.h"
+
+using namespace std;
+
+class Dictionary;
+
+// Constructs the reordering grammar from a text grammar and its rule
+// alignments: the reordering of every rule is inferred from its alignment, the
+// probabilities of rules with the same reordering are summed up and the rules
+// below the threshold are dropped. The result is written in the binary format
+// described in compiled_grammar.h.
+class GrammarCompiler {
+ public:
+  GrammarCompiler(ifstream& grammar_stream, ifstream& alignment_stream,
+                  Dictionary& dictionary, double penalty, double threshold,
+                  int max_leaves, int max_tree_size);
+
+  void Write(ostream& out, Dictionary& dictionary) const;
+
+  int GetNumRules() const;
+
+ private:
+  // Removes nonterminal-terminal and terminal-nonterminal links from the
+  // alignment. These links may appear due to symmetrization.
+  void RemoveMixedLinks(const Rule& rule, Alignment& alignment);
+
+  double penalty, threshold;
+  int max_leaves, max_tree_size;
+  RuleReorderer rule_reorderer;
+  map<int, vector<pair<Rule, double>>> rules;
+};
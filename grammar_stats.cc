@@ -0,0 +1,55 @@
+#include "grammar_stats.h"
+
+GrammarStats::GrammarStats() : num_rules(0), num_nodes(0) {}
+
+void GrammarStats::Update(const Rule& rule, int delta) {
+  num_rules += delta;
+  histogram[GetNumInteriorNodes(rule)] += delta;
+}
+
+void GrammarStats::AddNodes(long long num_nodes) {
+  this->num_nodes += num_nodes;
+}
+
+void GrammarStats::Add(const GrammarStats& stats) {
+  num_rules += stats.num_rules;
+  num_nodes += stats.num_nodes;
+  for (const auto& entry: stats.histogram) {
+    histogram[entry.first] += entry.second;
+  }
+}
+
+long long GrammarStats::GetNumRules() const {
+  return num_rules;
+}
+
+long long GrammarStats::GetNumInteriorNodes() const {
+  // Every split node is the root of exactly one rule.
+  return num_nodes - num_rules;
+}
+
+map<int, long long> GrammarStats::GetHistogram() const {
+  // Per thread stats may contain negative or zero entries, only the aggregated
+  // values are meaningful.
+  map<int, long long> result;
+  for (const auto& entry: histogram) {
+    if (entry.second != 0) {
+      result.insert(entry);
+    }
+  }
+  return result;
+}
+
+int GrammarStats::GetNumInteriorNodes(const Rule& rule) {
+  const AlignedTree& frag = rule.first;
+  int interior_nodes = frag.size() - 1;
+  if (frag.size() > 1) {
+    for (auto leaf = frag.begin_leaf(); leaf != frag.end_leaf(); ++leaf) {
+      if (leaf->IsSplitNode()) {
+        --interior_nodes;
+      }
+    }
+  }
+
+  return interior_nodes;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <map>
+
+#include "definitions.h"
+
+using namespace std;
+
+// Statistics about the rules in the current derivations. The statistics are
+// updated incrementally whenever a rule is added to or removed from a
+// derivation, so reading them does not require a pass over the corpus.
+class GrammarStats {
+ public:
+  GrammarStats();
+
+  void Update(const Rule& rule, int delta);
+
+  // Adds tree nodes to the total number of nodes, which does not change while
+  // sampling.
+  void AddNodes(long long num_nodes);
+
+  void Add(const GrammarStats& stats);
+
+  long long GetNumRules() const;
+
+  // The number of nodes which are not split nodes. Unlike the sum over the
+  // fragments, this includes the nodes not covered by any rule, e.g. the
+  // roots of trees without split nodes.
+  long long GetNumInteriorNodes() const;
+
+  // Maps the number of interior nodes to the number of rules having them.
+  map<int, long long> GetHistogram() const;
+
+  // Returns the number of nodes in the fragment that are neither the root nor
+  // a frontier variable.
+  static int GetNumInteriorNodes(const Rule& rule);
+
+ private:
+  long long num_rules, num_nodes;
+  map<int, long long> histogram;
+  // Avoid false sharing between the per thread stats.
+  char padding[64];
+};
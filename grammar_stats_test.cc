@@ -0,0 +1,116 @@
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "dictionary.h"
+#include "grammar_stats.h"
+#include "pcfg_table.h"
+#include "sampler.h"
+#include "synthetic_corpus.h"
+#include "translation_table.h"
+#include "util.h"
+
+using namespace std;
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+// Samples a small synthetic corpus with several threads and checks that the
+// grammar statistics maintained incrementally by the sampler are the same as
+// the statistics recounted from the final derivations.
+bool CheckGrammarStats(const fs::path& corpus_path, int num_threads) {
+  po::options_description options;
+  options.add_options()
+      ("trees", po::value<string>())
+      ("strings", po::value<string>())
+      ("alignment", po::value<string>())
+      ("forward-prob", po::value<string>())
+      ("reverse-prob", po::value<string>())
+      ("threads", po::value<int>());
+  vector<string> args = {
+      "--trees", (corpus_path / "corpus.trees").string(),
+      "--strings", (corpus_path / "corpus.target").string(),
+      "--alignment", (corpus_path / "corpus.align").string(),
+      "--forward-prob", (corpus_path / "fwd.probs").string(),
+      "--reverse-prob", (corpus_path / "rev.probs").string(),
+      "--threads", to_string(num_threads)};
+  po::variables_map vm;
+  po::store(po::command_line_parser(args).options(options).run(), vm);
+  po::notify(vm);
+
+  Dictionary dictionary;
+  shared_ptr<TranslationTable> forward_table, reverse_table;
+  LoadTranslationTables(vm, forward_table, reverse_table, dictionary);
+  auto training = make_shared<vector<Instance>>(
+      LoadTrainingData(vm, dictionary));
+  auto pcfg_table = make_shared<PCFGTable>(training);
+
+  RandomGenerator generator(1);
+  Sampler sampler(training, dictionary, pcfg_table, forward_table,
+                  reverse_table, nullptr, generator, num_threads, false,
+                  true, false, false, 0, false, 0.1, 5, 8, 1.0, 0.0001, 0.5,
+                  0.5, (corpus_path / "output.").string());
+  sampler.Sample(3, 1, 0, training->size());
+
+  GrammarStats stats = sampler.GetGrammarStats();
+  GrammarStats recount = sampler.RecountGrammarStats();
+  map<int, long long> histogram = stats.GetHistogram();
+  map<int, long long> recount_histogram = recount.GetHistogram();
+  cerr << "Threads: " << num_threads
+       << ", rules: " << stats.GetNumRules()
+       << " (recounted: " << recount.GetNumRules() << ")"
+       << ", interior nodes: " << stats.GetNumInteriorNodes()
+       << " (recounted: " << recount.GetNumInteriorNodes() << ")" << endl;
+  return stats.GetNumRules() == recount.GetNumRules() &&
+         stats.GetNumInteriorNodes() == recount.GetNumInteriorNodes() &&
+         histogram == recount_histogram;
+}
+
+int main(int argc, char** argv) {
+  fs::path corpus_path =
+      fs::temp_directory_path() / fs::unique_path("worm-stats-%%%%-%%%%");
+  fs::create_directories(corpus_path);
+
+  SyntheticCorpus corpus(10, 200, 15, 0.3, 0.1, 1);
+  ofstream forward_stream((corpus_path / "fwd.probs").string());
+  corpus.WriteTranslationTable(forward_stream, false);
+  forward_stream.close();
+  ofstream reverse_stream((corpus_path / "rev.probs").string());
+  corpus.WriteTranslationTable(reverse_stream, true);
+  reverse_stream.close();
+
+  // Includes single word sentences, whose trees may not have any split nodes.
+  ofstream tree_stream((corpus_path / "corpus.trees").string());
+  ofstream target_stream((corpus_path / "corpus.target").string());
+  ofstream alignment_stream((corpus_path / "corpus.align").string());
+  mt19937 length_generator(2);
+  uniform_int_distribution<int> length_distribution(1, 25);
+  for (int i = 0; i < 300; ++i) {
+    SyntheticSentence sentence =
+        corpus.GenerateSentence(length_distribution(length_generator));
+    tree_stream << sentence.tree << "\n";
+    target_stream << sentence.target_string << "\n";
+    alignment_stream << sentence.alignment << "\n";
+  }
+  tree_stream.close();
+  target_stream.close();
+  alignment_stream.close();
+
+  bool success = true;
+  for (int num_threads: {1, 4}) {
+    if (!CheckGrammarStats(corpus_path, num_threads)) {
+      cerr << "The incremental grammar statistics differ from the recounted "
+           << "statistics" << endl;
+      success = false;
+    }
+  }
+
+  fs::remove_all(corpus_path);
+  return success ? 0 : 1;
+}
@@ -1,3 +1,5 @@
+#include <iostream>
+
 #include <boost/program_options.hpp>
 
 #include "aligned_tree.h"
@@ -114,7 +116,7 @@ int main(int argc, char** argv) {
          parse_trees.size() == intersect_alignments.size());
 
   unordered_set<int> blacklisted_tags;
-  for (const string& tag: {"IN", "DT", "CC"}) {
+  for (const char* tag: {"IN", "DT", "CC"}) {
     blacklisted_tags.insert(dictionary.GetIndex(tag));
   }
   AlignmentHeuristic heuristic(
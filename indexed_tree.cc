@@ -0,0 +1,58 @@
+#include "indexed_tree.h"
+
+IndexedTree::IndexedTree(const AlignedTree& tree) {
+  int size = tree.size();
+  tags.reserve(size);
+  words.reserve(size);
+  num_children.reserve(size);
+  for (auto node = tree.begin(); node != tree.end(); ++node) {
+    tags.push_back(node->GetTag());
+    words.push_back(node->GetWord());
+    num_children.push_back(node.number_of_children());
+  }
+
+  // In preorder, a subtree ends where the subtree of the next sibling (or of
+  // the next sibling of an ancestor) begins.
+  subtree_ends.resize(size);
+  for (int node = size - 1; node >= 0; --node) {
+    int end = node + 1;
+    for (int i = 0; i < num_children[node]; ++i) {
+      end = subtree_ends[end];
+    }
+    subtree_ends[node] = end;
+  }
+}
+
+int IndexedTree::GetSize() const {
+  return tags.size();
+}
+
+int IndexedTree::GetTag(int node) const {
+  return tags[node];
+}
+
+bool IndexedTree::IsSetWord(int node) const {
+  return words[node] != -1;
+}
+
+int IndexedTree::GetWord(int node) const {
+  return words[node];
+}
+
+int IndexedTree::GetNumChildren(int node) const {
+  return num_children[node];
+}
+
+int IndexedTree::GetSubtreeEnd(int node) const {
+  return subtree_ends[node];
+}
+
+vector<int> IndexedTree::GetChildren(int node) const {
+  vector<int> children;
+  children.reserve(num_children[node]);
+  for (int child = node + 1, i = 0; i < num_children[node]; ++i) {
+    children.push_back(child);
+    child = subtree_ends[child];
+  }
+  return children;
+}
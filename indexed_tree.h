@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include "aligned_tree.h"
+
+using namespace std;
+
+// Numbers the nodes of a tree in preorder and keeps the attributes needed for
+// matching fragments in flat arrays indexed by node id, so that per node
+// tables (scores, matches) can be plain vectors instead of maps keyed by tree
+// iterators. The first child of a node is the node following it, and the next
+// sibling of a node starts where its subtree ends.
+class IndexedTree {
+ public:
+  IndexedTree(const AlignedTree& tree);
+
+  int GetSize() const;
+
+  int GetTag(int node) const;
+
+  bool IsSetWord(int node) const;
+
+  int GetWord(int node) const;
+
+  int GetNumChildren(int node) const;
+
+  // The id following the last node in the subtree of the node.
+  int GetSubtreeEnd(int node) const;
+
+  // The ids of the children of the node, from left to right.
+  vector<int> GetChildren(int node) const;
+
+ private:
+  vector<int> tags;
+  vector<int> words;
+  vector<int> num_children;
+  vector<int> subtree_ends;
+};
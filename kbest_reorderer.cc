@@ -0,0 +1,164 @@
+#include "kbest_reorderer.h"
+
+const int KBestReorderer::MAX_CANDIDATES_PER_RANK = 50;
+
+bool KBestReorderer::Derivation::operator<(const Derivation& other) const {
+  if (score != other.score) {
+    return score < other.score;
+  }
+  // Among equally good derivations, the first edge and the lowest ranks come
+  // out of the queue first.
+  if (edge != other.edge) {
+    return edge > other.edge;
+  }
+  return ranks > other.ranks;
+}
+
+KBestReorderer::NodeState::NodeState() :
+    initialized(false), has_last(false), num_popped(0) {}
+
+KBestReorderer::KBestReorderer(
+    const AlignedTree& tree,
+    const Grammar& grammar,
+    shared_ptr<RuleStatsReporter> reporter) :
+    ViterbiReorderer(tree, grammar, reporter),
+    states(GetTree().GetSize()) {}
+
+vector<pair<String, double>> KBestReorderer::ConstructReorderings(int k) {
+  vector<pair<String, double>> reorderings;
+  for (int rank = 0; rank < k && FindDerivation(0, rank); ++rank) {
+    const auto& derivation = states[0].derivations[rank];
+    String reordering = derivation.second;
+    for (size_t i = 0; i < reordering.size(); ++i) {
+      reordering[i].SetWordIndex(i);
+    }
+    reorderings.push_back(make_pair(reordering, derivation.first.score));
+  }
+  return reorderings;
+}
+
+bool KBestReorderer::FindDerivation(int node, int rank) {
+  NodeState& state = states[node];
+  if (!state.initialized) {
+    InitializeCandidates(node);
+  }
+
+  while ((int) state.derivations.size() <= rank) {
+    if (state.has_last) {
+      PushSuccessors(node, state.last);
+      state.has_last = false;
+    }
+    if (state.candidates.empty() ||
+        state.num_popped >= (rank + 1) * MAX_CANDIDATES_PER_RANK) {
+      return false;
+    }
+
+    state.last = state.candidates.top();
+    state.candidates.pop();
+    state.has_last = true;
+    ++state.num_popped;
+
+    String yield = ConstructYield(node, state.last);
+    if (state.yields.insert(yield).second) {
+      state.derivations.push_back(make_pair(state.last, move(yield)));
+    }
+  }
+
+  return true;
+}
+
+void KBestReorderer::InitializeCandidates(int node) {
+  states[node].initialized = true;
+  int num_edges = GetMatcher().GetRules(node).size();
+  if (num_edges == 0) {
+    PushCandidate(node, -1, vector<int>(GetTree().GetNumChildren(node), 0));
+    return;
+  }
+
+  for (int edge = 0; edge < num_edges; ++edge) {
+    int num_tails = GetMatcher().GetRules(node)[edge].num_frontier;
+    PushCandidate(node, edge, vector<int>(num_tails, 0));
+  }
+}
+
+void KBestReorderer::PushSuccessors(int node, const Derivation& derivation) {
+  vector<int> ranks = derivation.ranks;
+  for (size_t i = 0; i < ranks.size(); ++i) {
+    ++ranks[i];
+    PushCandidate(node, derivation.edge, ranks);
+    --ranks[i];
+  }
+}
+
+bool KBestReorderer::PushCandidate(int node, int edge,
+                                   const vector<int>& ranks) {
+  NodeState& state = states[node];
+  if (state.visited.count(make_pair(edge, ranks))) {
+    return true;
+  }
+
+  Derivation derivation;
+  derivation.edge = edge;
+  derivation.ranks = ranks;
+  if (edge == -1) {
+    derivation.score = NO_MATCH;
+  } else {
+    const auto& match = GetMatcher().GetRules(node)[edge];
+    derivation.score = GetMatcher().GetRule(node, match).second;
+  }
+
+  vector<int> tails = GetTails(node, edge);
+  for (size_t i = 0; i < tails.size(); ++i) {
+    if (!FindDerivation(tails[i], ranks[i])) {
+      return false;
+    }
+    derivation.score += states[tails[i]].derivations[ranks[i]].first.score;
+  }
+
+  state.visited.insert(make_pair(edge, ranks));
+  state.candidates.push(derivation);
+  return true;
+}
+
+vector<int> KBestReorderer::GetTails(int node, int edge) const {
+  if (edge == -1) {
+    return GetTree().GetChildren(node);
+  }
+
+  const auto& match = GetMatcher().GetRules(node)[edge];
+  const int* frontier = GetMatcher().GetFrontier(match);
+  return vector<int>(frontier, frontier + match.num_frontier);
+}
+
+String KBestReorderer::ConstructYield(
+    int node, const Derivation& derivation) const {
+  String yield;
+  vector<int> tails = GetTails(node, derivation.edge);
+  if (derivation.edge == -1) {
+    if (tails.empty()) {
+      // Unknown terminal.
+      yield.push_back(StringNode(GetTree().GetWord(node), -1, -1));
+    }
+    for (size_t i = 0; i < tails.size(); ++i) {
+      const String& tail_yield =
+          states[tails[i]].derivations[derivation.ranks[i]].second;
+      yield.insert(yield.end(), tail_yield.begin(), tail_yield.end());
+    }
+    return yield;
+  }
+
+  const auto& match = GetMatcher().GetRules(node)[derivation.edge];
+  const String& target_string = GetMatcher().GetRule(node, match).first.second;
+  for (const auto& target_node: target_string) {
+    if (target_node.IsSetWord()) {
+      yield.push_back(target_node);
+    } else {
+      int var_index = target_node.GetVarIndex();
+      const String& tail_yield =
+          states[tails[var_index]].derivations[derivation.ranks[var_index]]
+              .second;
+      yield.insert(yield.end(), tail_yield.begin(), tail_yield.end());
+    }
+  }
+  return yield;
+}
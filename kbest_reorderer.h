@@ -0,0 +1,93 @@
+#ifndef _KBEST_REORDERER_H_
+#define _KBEST_REORDERER_H_
+
+#include <queue>
+#include <set>
+#include <vector>
+
+#include "viterbi_reorderer.h"
+
+using namespace std;
+
+// Enumerates the best derivations of the tree in the order of their scores,
+// with the lazy k-best algorithm of Huang and Chiang (2005, algorithm 3) over
+// the hypergraph of rule matches. A node only gets a new derivation when a
+// derivation of one of its ancestors needs it, starting from the Viterbi
+// derivations found by the inside pass.
+//
+// Different derivations often produce the same reordering. Such duplicates
+// are dropped at every node, keeping the best derivation of each distinct
+// yield, since a worse derivation of the same yield can never be part of a
+// better derivation of the whole tree.
+//
+// The search is approximate: a node gives up after MAX_CANDIDATES_PER_RANK
+// candidates per requested derivation, to bound the work spent on trees
+// where most derivations are duplicates. The reorderings returned are still
+// distinct and in the order of their scores, but there may be fewer than k
+// of them, and reorderings which need a derivation a node gave up on are
+// missing from the list.
+class KBestReorderer: public ViterbiReorderer {
+ public:
+  KBestReorderer(
+      const AlignedTree& tree,
+      const Grammar& grammar,
+      shared_ptr<RuleStatsReporter> reporter);
+
+  // Returns up to k distinct reorderings with their scores, best first. See
+  // above for when fewer than k reorderings are returned.
+  vector<pair<String, double>> ConstructReorderings(int k);
+
+ private:
+  // A derivation of a node: the incoming edge (the index of a match, -1 for
+  // keeping the children of a node without matches in order) and the rank of
+  // the derivation of each of its tail nodes.
+  struct Derivation {
+    bool operator<(const Derivation& other) const;
+
+    int edge;
+    vector<int> ranks;
+    double score;
+  };
+
+  struct NodeState {
+    NodeState();
+
+    bool initialized;
+    // The distinct derivations found so far, best first, with their yields.
+    vector<pair<Derivation, String>> derivations;
+    priority_queue<Derivation> candidates;
+    set<pair<int, vector<int>>> visited;
+    set<String> yields;
+    // The last derivation taken from the candidates, which still has to be
+    // replaced by its successors.
+    Derivation last;
+    bool has_last;
+    int num_popped;
+  };
+
+  // Finds the derivation of the node with the given rank, if there is one.
+  bool FindDerivation(int node, int rank);
+
+  void InitializeCandidates(int node);
+
+  // Adds the derivations which differ from the given one in the rank of one
+  // tail node.
+  void PushSuccessors(int node, const Derivation& derivation);
+
+  // Returns false if one of the tail derivations does not exist.
+  bool PushCandidate(int node, int edge, const vector<int>& ranks);
+
+  // The frontier nodes of the match, or the children of the node for the
+  // edge keeping them in order.
+  vector<int> GetTails(int node, int edge) const;
+
+  String ConstructYield(int node, const Derivation& derivation) const;
+
+  // Bounds the work spent on duplicates: a node gives up after this many
+  // candidates per distinct derivation it was asked for.
+  static const int MAX_CANDIDATES_PER_RANK;
+
+  vector<NodeState> states;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "memory_util.h"
+
+#include <fstream>
+#include <iomanip>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+long long GetPeakRSS() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // Reported in kilobytes on Linux.
+  return usage.ru_maxrss * 1024LL;
+}
+
+long long GetCurrentRSS() {
+  ifstream fin("/proc/self/statm");
+  long long total_pages, resident_pages;
+  if (!(fin >> total_pages >> resident_pages)) {
+    return 0;
+  }
+  return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+long long GetMemoryUsage(const AlignedTree& tree) {
+  // The head and the feet of the tree are allocated as well.
+  return (tree.size() + 2) * sizeof(tree_node_<AlignedNode>);
+}
+
+long long GetMemoryUsage(const String& target_string) {
+  // Short strings are stored inside the object itself.
+  if (target_string.capacity() <= STRING_INLINE_SIZE) {
+    return 0;
+  }
+  return target_string.capacity() * sizeof(StringNode);
+}
+
+long long GetMemoryUsage(const pair<AlignedTree, String>& rule) {
+  return GetMemoryUsage(rule.first) + GetMemoryUsage(rule.second);
+}
+
+void MemoryReport::Add(const string& name, long long bytes) {
+  entries.push_back(Entry{name, bytes, false});
+}
+
+void MemoryReport::AddDetail(const string& name, long long bytes) {
+  entries.push_back(Entry{"  " + name, bytes, true});
+}
+
+void MemoryReport::Write(ostream& out) const {
+  long long total = 0;
+  for (const auto& entry: entries) {
+    if (!entry.detail) {
+      total += entry.bytes;
+    }
+  }
+
+  auto write_row = [&out](const string& name, long long bytes) {
+    out << "  " << left << setw(40) << name << right << fixed
+        << setprecision(1) << setw(12) << bytes / (1024.0 * 1024.0)
+        << " MB" << endl;
+  };
+
+  out << "Memory usage:" << endl;
+  for (const auto& entry: entries) {
+    write_row(entry.name, entry.bytes);
+  }
+  write_row("Total (accounted)", total);
+  write_row("Resident set size", GetCurrentRSS());
+  write_row("Peak resident set size", GetPeakRSS());
+  out.unsetf(ios::floatfield);
+  out << setprecision(6);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "definitions.h"
+
+using namespace std;
+
+// Approximate number of bytes allocated for each element of the node based
+// standard containers, on top of the element itself.
+const long long MAP_NODE_OVERHEAD = 32;
+const long long HASH_NODE_OVERHEAD = 16;
+
+// Returns the peak resident set size of the process in bytes.
+long long GetPeakRSS();
+
+// Returns the current resident set size of the process in bytes.
+long long GetCurrentRSS();
+
+// The functions below approximate the heap memory owned by a data structure,
+// ignoring the overhead of the allocator. The size of the object itself is not
+// included.
+long long GetMemoryUsage(const AlignedTree& tree);
+
+long long GetMemoryUsage(const String& target_string);
+
+long long GetMemoryUsage(const pair<AlignedTree, String>& rule);
+
+// Excludes the memory owned by the keys and the values.
+template<class Key, class Value>
+long long GetMemoryUsage(const map<Key, Value>& container) {
+  return container.size() *
+      (sizeof(pair<const Key, Value>) + MAP_NODE_OVERHEAD);
+}
+
+// Excludes the memory owned by the keys and the values.
+template<class Key, class Value, class Hash>
+long long GetMemoryUsage(const unordered_map<Key, Value, Hash>& container) {
+  return container.size() *
+      (sizeof(pair<const Key, Value>) + HASH_NODE_OVERHEAD) +
+      container.bucket_count() * sizeof(void*);
+}
+
+// Collects the memory used by the major data structures of a program and
+// displays it as a table, together with the memory usage of the process.
+class MemoryReport {
+ public:
+  void Add(const string& name, long long bytes);
+
+  // Adds a breakdown of the previous entry, not counted towards the total.
+  void AddDetail(const string& name, long long bytes);
+
+  void Write(ostream& out) const;
+
+ private:
+  struct Entry {
+    string name;
+    long long bytes;
+    bool detail;
+  };
+
+  vector<Entry> entries;
+};
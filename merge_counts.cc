@@ -0,0 +1,107 @@
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "aligned_tree.h"
+#include "dictionary.h"
+#include "rule_count_file.h"
+#include "time_util.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+typedef pair<RuleCountEntry, int> HeapEntry;
+
+int main(int argc, char** argv) {
+  po::options_description cmdline_specific("Command line options");
+  cmdline_specific.add_options()
+      ("help,h", "Show available options")
+      ("config,c", po::value<string>(), "Path to config file");
+
+  po::options_description general_options("General options");
+  general_options.add_options()
+      ("input,i", po::value<vector<string>>()->multitoken()->required(),
+          "Rule count files to be merged")
+      ("output,o", po::value<string>()->required(),
+          "Output file for the merged rule counts");
+
+  po::positional_options_description positional_options;
+  positional_options.add("input", -1);
+
+  po::variables_map vm;
+  po::options_description cmdline_options;
+  cmdline_options.add(cmdline_specific).add(general_options);
+  po::store(po::command_line_parser(argc, argv)
+                .options(cmdline_options)
+                .positional(positional_options)
+                .run(), vm);
+
+  if (vm.count("help")) {
+    cout << cmdline_options << endl;
+    return 0;
+  }
+
+  if (vm.count("config")) {
+    po::options_description config_options;
+    config_options.add(general_options);
+    ifstream config_stream(vm["config"].as<string>());
+    po::store(po::parse_config_file(config_stream, config_options), vm);
+  }
+
+  po::notify(vm);
+
+  auto start_time = GetTime();
+  vector<string> input_files = vm["input"].as<vector<string>>();
+  // All files must share the same dictionary.
+  Dictionary dictionary;
+  vector<shared_ptr<RuleCountReader>> readers;
+  for (const string& input_file: input_files) {
+    readers.push_back(make_shared<RuleCountReader>(input_file, dictionary));
+  }
+
+  // K-way merge with a min-heap holding the next entry of every file.
+  auto compare = [](const HeapEntry& entry1, const HeapEntry& entry2) {
+    return entry2.first < entry1.first;
+  };
+  priority_queue<HeapEntry, vector<HeapEntry>, decltype(compare)> heap(compare);
+  for (size_t i = 0; i < readers.size(); ++i) {
+    RuleCountEntry entry;
+    if (readers[i]->Next(entry)) {
+      heap.push(make_pair(entry, i));
+    }
+  }
+
+  RuleCountWriter writer(vm["output"].as<string>(), dictionary);
+  long long num_entries = 0, num_rules = 0;
+  while (!heap.empty()) {
+    RuleCountEntry merged_entry = heap.top().first;
+    merged_entry.count = 0;
+    while (!heap.empty() && heap.top().first == merged_entry) {
+      HeapEntry entry = heap.top();
+      heap.pop();
+      merged_entry.count += entry.first.count;
+      ++num_entries;
+
+      int reader = entry.second;
+      if (readers[reader]->Next(entry.first)) {
+        heap.push(entry);
+      }
+    }
+
+    if (merged_entry.count != 0) {
+      writer.Write(merged_entry);
+      ++num_rules;
+    }
+  }
+
+  auto end_time = GetTime();
+  cerr << "Merged " << num_entries << " entries from " << readers.size()
+       << " files into " << num_rules << " rules in "
+       << GetDuration(start_time, end_time) << " seconds..." << endl;
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include "metrics.h"
+
+#include <omp.h>
+
+static const char* PHASE_NAMES[NUM_PHASES] = {
+  "sample_alignments",
+  "sample_swaps",
+  "extract_rule",
+  "base_probability",
+  "restaurant_lookup",
+  "legal_spans",
+  "synchronize",
+  "serialize"
+};
+
+static const char* COUNTER_NAMES[NUM_COUNTERS] = {
+  "nodes_sampled",
+  "swaps_sampled",
+  "legal_spans",
+  "rules_extracted",
+  "restaurant_lookups",
+  "restaurant_hits"
+};
+
+bool Metrics::enabled = false;
+vector<Metrics::ThreadMetrics> Metrics::thread_metrics;
+
+Metrics::ThreadMetrics::ThreadMetrics() : current_phase(NUM_PHASES) {
+  fill(counters, counters + NUM_COUNTERS, 0);
+  fill(nanoseconds, nanoseconds + NUM_PHASES, 0);
+  fill(allocations, allocations + NUM_PHASES + 1, 0);
+  fill(allocated_bytes, allocated_bytes + NUM_PHASES + 1, 0);
+}
+
+void Metrics::Enable(int max_threads) {
+  thread_metrics.resize(max_threads);
+  enabled = true;
+}
+
+bool Metrics::IsEnabled() {
+  return enabled;
+}
+
+Metrics::ThreadMetrics& Metrics::GetThreadMetrics() {
+  return thread_metrics[omp_get_thread_num()];
+}
+
+void Metrics::Increment(MetricsCounter counter, long long value) {
+  if (enabled) {
+    GetThreadMetrics().counters[counter] += value;
+  }
+}
+
+MetricsPhase Metrics::GetCurrentPhase() {
+  if (!enabled) {
+    return NUM_PHASES;
+  }
+  return GetThreadMetrics().current_phase;
+}
+
+void Metrics::RecordAllocation(size_t bytes) {
+  if (!enabled) {
+    return;
+  }
+
+  size_t thread_id = omp_get_thread_num();
+  if (thread_id >= thread_metrics.size()) {
+    return;
+  }
+
+  auto& metrics = thread_metrics[thread_id];
+  ++metrics.allocations[metrics.current_phase];
+  metrics.allocated_bytes[metrics.current_phase] += bytes;
+}
+
+void Metrics::WriteJSON(ostream& out, int iteration) {
+  ThreadMetrics total;
+  for (auto& metrics: thread_metrics) {
+    for (int i = 0; i < NUM_COUNTERS; ++i) {
+      total.counters[i] += metrics.counters[i];
+    }
+    for (int i = 0; i < NUM_PHASES; ++i) {
+      total.nanoseconds[i] += metrics.nanoseconds[i];
+    }
+    for (int i = 0; i <= NUM_PHASES; ++i) {
+      total.allocations[i] += metrics.allocations[i];
+      total.allocated_bytes[i] += metrics.allocated_bytes[i];
+    }
+    metrics = ThreadMetrics();
+  }
+
+  out << "{\"iteration\": " << iteration;
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    out << ", \"" << COUNTER_NAMES[i] << "\": " << total.counters[i];
+  }
+  // Times are summed up over all threads.
+  for (int i = 0; i < NUM_PHASES; ++i) {
+    out << ", \"" << PHASE_NAMES[i] << "_seconds\": "
+        << total.nanoseconds[i] / 1e9;
+  }
+#ifdef WORM_ALLOC_PROFILE
+  // Unlike the times, allocations are only attributed to the innermost phase.
+  for (int i = 0; i <= NUM_PHASES; ++i) {
+    const char* name = i < NUM_PHASES ? PHASE_NAMES[i] : "other";
+    out << ", \"" << name << "_allocations\": " << total.allocations[i]
+        << ", \"" << name << "_allocated_bytes\": "
+        << total.allocated_bytes[i];
+  }
+#endif
+  out << "}" << endl;
+}
+
+ScopedPhase::ScopedPhase(MetricsPhase phase) : phase(phase) {
+  if (Metrics::enabled) {
+    auto& metrics = Metrics::GetThreadMetrics();
+    previous_phase = metrics.current_phase;
+    metrics.current_phase = phase;
+    start_time = steady_clock::now();
+  }
+}
+
+ScopedPhase::~ScopedPhase() {
+  if (Metrics::enabled) {
+    auto end_time = steady_clock::now();
+    auto& metrics = Metrics::GetThreadMetrics();
+    metrics.nanoseconds[phase] +=
+        duration_cast<nanoseconds>(end_time - start_time).count();
+    metrics.current_phase = previous_phase;
+  }
+}
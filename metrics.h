@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+enum MetricsPhase {
+  PHASE_SAMPLE_ALIGNMENTS,
+  PHASE_SAMPLE_SWAPS,
+  PHASE_EXTRACT_RULE,
+  PHASE_BASE_PROBABILITY,
+  PHASE_RESTAURANT_LOOKUP,
+  PHASE_LEGAL_SPANS,
+  PHASE_SYNCHRONIZE,
+  PHASE_SERIALIZE,
+  NUM_PHASES
+};
+
+enum MetricsCounter {
+  COUNTER_NODES_SAMPLED,
+  COUNTER_SWAPS_SAMPLED,
+  COUNTER_LEGAL_SPANS,
+  COUNTER_RULES_EXTRACTED,
+  COUNTER_RESTAURANT_LOOKUPS,
+  COUNTER_RESTAURANT_HITS,
+  NUM_COUNTERS
+};
+
+// Per thread counters and timers for the hot paths of the sampler. Every
+// thread only updates its own slot, the slots are aggregated once per
+// iteration, after the threads have been joined. Phases may be nested, the
+// time reported for a phase includes the time spent in nested phases.
+class Metrics {
+ public:
+  static void Enable(int max_threads);
+
+  static bool IsEnabled();
+
+  static void Increment(MetricsCounter counter, long long value = 1);
+
+  // Returns the innermost phase of the calling thread or NUM_PHASES if the
+  // thread is not in any phase.
+  static MetricsPhase GetCurrentPhase();
+
+  // Attributes an allocation to the innermost phase of the calling thread.
+  // Called by the allocation hooks in builds with WORM_ALLOC_PROFILE. Must not
+  // allocate memory.
+  static void RecordAllocation(size_t bytes);
+
+  // Writes the aggregated values as a single line JSON object and resets them.
+  static void WriteJSON(ostream& out, int iteration);
+
+ private:
+  friend class ScopedPhase;
+
+  struct ThreadMetrics {
+    ThreadMetrics();
+
+    long long counters[NUM_COUNTERS];
+    long long nanoseconds[NUM_PHASES];
+    // The last entry counts the allocations made outside of any phase.
+    long long allocations[NUM_PHASES + 1];
+    long long allocated_bytes[NUM_PHASES + 1];
+    MetricsPhase current_phase;
+    // Avoid false sharing between threads.
+    char padding[64];
+  };
+
+  static ThreadMetrics& GetThreadMetrics();
+
+  static bool enabled;
+  static vector<ThreadMetrics> thread_metrics;
+};
+
+// Attributes the time until the end of the scope to the given phase.
+class ScopedPhase {
+ public:
+  ScopedPhase(MetricsPhase phase);
+
+  ~ScopedPhase();
+
+ private:
+  MetricsPhase phase, previous_phase;
+  steady_clock::time_point start_time;
+};
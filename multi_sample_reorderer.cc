@@ -2,21 +2,52 @@
 
 #include "grammar.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
+const int MultiSampleReorderer::SAMPLES_PER_CHUNK = 32;
+const int MultiSampleReorderer::CHUNKS_PER_ROUND = 4;
+
 MultiSampleReorderer::MultiSampleReorderer(
     const AlignedTree& tree,
     const Grammar& grammar,
     shared_ptr<RuleStatsReporter> reporter,
-    RandomGenerator& generator,
-    unsigned int num_iterations) :
-    reorderer(tree, grammar, reporter, generator),
-    num_iterations(num_iterations) {}
+    unsigned int seed,
+    unsigned int num_iterations,
+    double early_stop) :
+    seed(seed), generator(seed), reorderer(tree, grammar, reporter, generator),
+    num_iterations(num_iterations), early_stop(early_stop) {}
 
 String MultiSampleReorderer::ConstructReordering() {
+  int num_chunks = (num_iterations + SAMPLES_PER_CHUNK - 1) / SAMPLES_PER_CHUNK;
+  int chunks_per_round = early_stop > 0 ? CHUNKS_PER_ROUND : num_chunks;
+  // The counts are tested after every round but the last, so the bound is
+  // raised such that the probability of stopping early by chance in any of
+  // those tests is at most that of a single test at early_stop standard
+  // deviations (union bound, using exp(-z^2 / 2) for the normal tail).
+  int num_rounds = (num_chunks + chunks_per_round - 1) / chunks_per_round;
+  double threshold =
+      sqrt(early_stop * early_stop + 2 * log(max(1, num_rounds - 1)));
   map<String, int> reordering_counts;
-  for (unsigned int i = 0; i < num_iterations; ++i) {
-    ++reordering_counts[reorderer.ConstructReordering()];
+  for (int first = 0; first < num_chunks; first += chunks_per_round) {
+    int last = min(num_chunks, first + chunks_per_round);
+    vector<map<String, int>> chunk_counts(last - first);
+    for (int chunk = first; chunk < last; ++chunk) {
+      #pragma omp task shared(chunk_counts)
+      DrawSamples(chunk, chunk_counts[chunk - first]);
+    }
+    #pragma omp taskwait
+
+    for (const auto& counts: chunk_counts) {
+      for (const auto& reordering: counts) {
+        reordering_counts[reordering.first] += reordering.second;
+      }
+    }
+
+    if (early_stop > 0 && IsSettled(reordering_counts, threshold)) {
+      break;
+    }
   }
 
   String result;
@@ -30,3 +61,31 @@ String MultiSampleReorderer::ConstructReordering() {
 
   return result;
 }
+
+void MultiSampleReorderer::DrawSamples(
+    int chunk, map<String, int>& reordering_counts) const {
+  seed_seq chunk_seed{seed, (unsigned int) chunk};
+  RandomGenerator chunk_generator(chunk_seed);
+  int first = chunk * SAMPLES_PER_CHUNK;
+  int last = min((int) num_iterations, first + SAMPLES_PER_CHUNK);
+  for (int i = first; i < last; ++i) {
+    ++reordering_counts[reorderer.SampleReordering(chunk_generator)];
+  }
+}
+
+bool MultiSampleReorderer::IsSettled(
+    const map<String, int>& reordering_counts, double threshold) const {
+  int best = 0, second_best = 0;
+  for (const auto& reordering: reordering_counts) {
+    if (reordering.second > best) {
+      second_best = best;
+      best = reordering.second;
+    } else if (reordering.second > second_best) {
+      second_best = reordering.second;
+    }
+  }
+
+  // Under the hypothesis that both are equally likely, the difference of the
+  // counts has mean 0 and variance best + second_best.
+  return best - second_best >= threshold * sqrt(best + second_best);
+}
@@ -1,25 +1,52 @@
 #ifndef _MULTI_SAMPLE_REORDERER_H_
 #define _MULTI_SAMPLE_REORDERER_H_
 
+#include <map>
+
 #include "reorderer_base.h"
 #include "single_sample_reorderer.h"
 
 class Grammar;
 
+// Returns the most frequent of num_iterations sampled reorderings. The samples
+// are drawn in chunks, each from its own random stream derived from the seed,
+// and the chunks are run as OpenMP tasks, so that idle threads can help with
+// long sentences. The result only depends on the seed, not on the number of
+// threads.
+//
+// If early_stop is positive, the chunks are drawn in rounds, and sampling
+// stops after the first round in which the lead of the most frequent
+// reordering over the runner-up is significant (sign test). Since the test is
+// repeated after every round, the bound of early_stop standard deviations is
+// raised with the number of rounds, so that the chance of stopping on a tie
+// stays that of a single test.
 class MultiSampleReorderer: public ReordererBase {
  public:
   MultiSampleReorderer(
       const AlignedTree& tree,
       const Grammar& grammar,
       shared_ptr<RuleStatsReporter> reporter,
-      RandomGenerator& generator,
-      unsigned int num_iterations);
+      unsigned int seed,
+      unsigned int num_iterations,
+      double early_stop = 0);
 
   String ConstructReordering();
 
  private:
+  void DrawSamples(int chunk, map<String, int>& reordering_counts) const;
+
+  bool IsSettled(const map<String, int>& reordering_counts,
+                 double threshold) const;
+
+  static const int SAMPLES_PER_CHUNK;
+  static const int CHUNKS_PER_ROUND;
+
+  unsigned int seed;
+  // Only used by the single sample reorderer outside of the chunks.
+  RandomGenerator generator;
   SingleSampleReorderer reorderer;
   unsigned int num_iterations;
+  double early_stop;
 };
 
 #endif
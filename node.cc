@@ -1,5 +1,76 @@
 #include "node.h"
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+// Word indexes and spans which do not fit in the 16 bit fields of the nodes.
+// Equal entries share a key, so the table only grows with the number of
+// distinct (word index, span) triples of the long sentences. The entries are
+// stored in chunks that are never moved or freed, so they can be read without
+// locking.
+class WideIndexTable {
+ public:
+  WideIndexTable() {
+    for (auto& chunk: chunks) {
+      chunk.store(nullptr, memory_order_relaxed);
+    }
+  }
+
+  uint32_t Insert(int word_index, int start, int end) {
+    lock_guard<mutex> lock(insert_lock);
+    auto result = keys.insert(make_pair(
+        make_tuple(word_index, start, end), (uint32_t) keys.size()));
+    if (result.second) {
+      uint32_t key = result.first->second;
+      WideIndexes* chunk = chunks[key >> CHUNK_BITS].load(memory_order_relaxed);
+      if (chunk == nullptr) {
+        chunk = new WideIndexes[1 << CHUNK_BITS];
+        chunks[key >> CHUNK_BITS].store(chunk, memory_order_release);
+      }
+      chunk[key & ((1 << CHUNK_BITS) - 1)] = {word_index, start, end};
+    }
+    return result.first->second;
+  }
+
+  void Get(uint32_t key, int& word_index, int& start, int& end) const {
+    const WideIndexes& entry =
+        chunks[key >> CHUNK_BITS].load(memory_order_acquire)
+            [key & ((1 << CHUNK_BITS) - 1)];
+    word_index = entry.word_index;
+    start = entry.start;
+    end = entry.end;
+  }
+
+ private:
+  struct WideIndexes {
+    int32_t word_index, start, end;
+  };
+
+  // The keys are stored in the two 16 bit span fields.
+  static const int CHUNK_BITS = 16;
+
+  mutex insert_lock;
+  map<tuple<int, int, int>, uint32_t> keys;
+  atomic<WideIndexes*> chunks[1 << (32 - CHUNK_BITS)];
+};
+
+// Never destroyed, since nodes may still be read while the static objects are
+// destroyed.
+static WideIndexTable& GetWideIndexTable() {
+  static WideIndexTable* table = new WideIndexTable();
+  return *table;
+}
+
+static bool FitsCompact(int value) {
+  return value > INT16_MIN && value <= INT16_MAX;
+}
+
+static uint32_t GetWideKey(int16_t start, int16_t end) {
+  return ((uint32_t) (uint16_t) start << 16) | (uint16_t) end;
+}
+
 AlignedNode::AlignedNode() :
     tag(-1), word(-1), word_index(-1), start(-1), end(-1), split_node(false) {}
 
@@ -28,15 +99,24 @@ void AlignedNode::SetWord(int value) {
 }
 
 void AlignedNode::UnsetWord() {
-  word = word_index = -1;
+  word = -1;
+  pair<int, int> span = GetSpan();
+  SetIndexes(-1, span.first, span.second);
 }
 
 int AlignedNode::GetWordIndex() const {
-  return word_index;
+  if (word_index != WIDE_INDEXES) {
+    return word_index;
+  }
+  int wide_word_index, wide_start, wide_end;
+  GetWideIndexTable().Get(
+      GetWideKey(start, end), wide_word_index, wide_start, wide_end);
+  return wide_word_index;
 }
 
 void AlignedNode::SetWordIndex(int value) {
-  word_index = value;
+  pair<int, int> span = GetSpan();
+  SetIndexes(value, span.first, span.second);
 }
 
 bool AlignedNode::IsSplitNode() const {
@@ -48,12 +128,33 @@ void AlignedNode::SetSplitNode(bool value) {
 }
 
 pair<int, int> AlignedNode::GetSpan() const {
-  return make_pair(start, end);
+  if (word_index != WIDE_INDEXES) {
+    return make_pair(start, end);
+  }
+  int wide_word_index, wide_start, wide_end;
+  GetWideIndexTable().Get(
+      GetWideKey(start, end), wide_word_index, wide_start, wide_end);
+  return make_pair(wide_start, wide_end);
 }
 
 void AlignedNode::SetSpan(const pair<int, int>& span) {
-  start = span.first;
-  end = span.second;
+  SetIndexes(GetWordIndex(), span.first, span.second);
+}
+
+void AlignedNode::SetIndexes(
+    int new_word_index, int new_start, int new_end) {
+  if (FitsCompact(new_word_index) && FitsCompact(new_start) &&
+      FitsCompact(new_end)) {
+    word_index = new_word_index;
+    start = new_start;
+    end = new_end;
+  } else {
+    uint32_t key =
+        GetWideIndexTable().Insert(new_word_index, new_start, new_end);
+    word_index = WIDE_INDEXES;
+    start = (int16_t) (key >> 16);
+    end = (int16_t) (key & 0xFFFF);
+  }
 }
 
 bool AlignedNode::operator<(const AlignedNode& node) const {
@@ -66,14 +167,22 @@ bool AlignedNode::operator!=(const AlignedNode& node) const {
 
 
 StringNode::StringNode(int word, int word_index, int var_index) :
-    word(word), word_index(word_index), var_index(var_index) {}
+    word_index(word_index) {
+  if (word != -1) {
+    symbol = word;
+  } else if (var_index != -1) {
+    symbol = NO_SYMBOL + 1 + var_index;
+  } else {
+    symbol = NO_SYMBOL;
+  }
+}
 
 bool StringNode::IsSetWord() const {
-  return word != -1;
+  return symbol >= 0;
 }
 
 int StringNode::GetWord() const {
-  return word;
+  return symbol >= 0 ? symbol : -1;
 }
 
 int StringNode::GetWordIndex() const {
@@ -85,13 +194,13 @@ void StringNode::SetWordIndex(int value) {
 }
 
 int StringNode::GetVarIndex() const {
-  return var_index;
+  return symbol < 0 && symbol != NO_SYMBOL ? symbol - NO_SYMBOL - 1 : -1;
 }
 
 bool StringNode::operator<(const StringNode& node) const {
-  return word < node.word || (word == node.word && var_index < node.var_index);
+  return symbol < node.symbol;
 }
 
 bool StringNode::operator==(const StringNode& node) const {
-  return word == node.word && var_index == node.var_index;
+  return symbol == node.symbol;
 }
@@ -1,10 +1,15 @@
 #ifndef _NODE_H_
 #define _NODE_H_
 
+#include <cstdint>
 #include <utility>
 
 using namespace std;
 
+// The word index and the span are stored in 16 bits. If any of them does not
+// fit, as in sentences with more than 32767 words, the three values are moved
+// to a table shared by all nodes and the fields hold their key in the table
+// instead, marked by WIDE_INDEXES as the word index.
 class AlignedNode {
  public:
   AlignedNode();
@@ -40,8 +45,12 @@ class AlignedNode {
   bool operator!=(const AlignedNode& node) const;
 
  private:
-  int tag, word, word_index;
-  int start, end;
+  void SetIndexes(int new_word_index, int new_start, int new_end);
+
+  static const int16_t WIDE_INDEXES = INT16_MIN;
+
+  int32_t tag, word;
+  int16_t word_index, start, end;
   bool split_node;
 };
 
@@ -64,7 +73,15 @@ class StringNode {
   bool operator==(const StringNode& node) const;
 
  private:
-  int word, word_index, var_index;
+  // Words and variables are mutually exclusive and share the same field.
+  // Variables are mapped to negative values such that the nodes are ordered in
+  // the same way as by (word, var_index).
+  static const int32_t NO_SYMBOL = INT32_MIN;
+
+  // Padding makes the node 8 bytes either way, so the word index is not
+  // narrowed.
+  int32_t symbol;
+  int32_t word_index;
 };
 
 #endif
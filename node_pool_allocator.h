@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+using namespace std;
+
+// Stateless allocator for tree nodes. Freed nodes are kept in a per thread free
+// list and new nodes are carved out of large slabs, so building and destroying
+// fragments does not go through malloc for every node.
+//
+// When the free list of a thread reaches BATCH_SIZE nodes, it is set aside as
+// a full batch and the thread starts a new free list. A thread keeps at most
+// one full batch, further batches move to a list shared by all threads, from
+// which a thread takes a batch before allocating a new slab. Nodes freed by
+// another thread than the one that allocated them (e.g. trees parsed by a
+// reader thread and destroyed by worker threads) are therefore reused, and
+// every thread retains fewer than 2 * BATCH_SIZE free nodes. Slabs are never
+// returned to the system, but their number is bounded by the peak number of
+// live nodes.
+template<class T>
+class NodePoolAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template<class U>
+  struct rebind {
+    typedef NodePoolAllocator<U> other;
+  };
+
+  NodePoolAllocator() {}
+
+  template<class U>
+  NodePoolAllocator(const NodePoolAllocator<U>&) {}
+
+  T* allocate(size_t n, const void* hint = 0);
+
+  void deallocate(T* pointer, size_t n);
+
+  void construct(T* pointer, const T& value) {
+    new (pointer) T(value);
+  }
+
+  void destroy(T* pointer) {
+    pointer->~T();
+  }
+
+  bool operator==(const NodePoolAllocator&) const {
+    return true;
+  }
+
+  bool operator!=(const NodePoolAllocator&) const {
+    return false;
+  }
+
+ private:
+  union FreeNode {
+    FreeNode* next;
+    char data[sizeof(T)];
+  };
+
+  struct FreeList {
+    FreeNode* head;
+    size_t size;
+  };
+
+  struct ThreadPool {
+    FreeList free_list;
+    FreeList full_batch;
+    FreeNode* slab_start;
+    FreeNode* slab_end;
+  };
+
+  // Hands the free nodes of the thread over to the other threads when the
+  // thread exits. Kept apart from the pool and only touched on the slow paths,
+  // since every access to a thread local object with a destructor goes
+  // through an initialization check.
+  struct ThreadPoolReleaser {
+    ~ThreadPoolReleaser();
+
+    bool active;
+  };
+
+  struct SharedPool {
+    mutex lock;
+    vector<FreeList> batches;
+  };
+
+  static void ReleaseBatch(const FreeList& batch);
+
+  // Called when the free list, the full batch and the slab of the thread are
+  // all used up, so that the shared pool is only locked once per batch or
+  // slab. Takes a batch from the shared pool or, if there is none, allocates a
+  // slab.
+  static void Refill(ThreadPool& pool);
+
+  // Never destroyed, since threads may still release nodes while the static
+  // objects are destroyed.
+  static SharedPool& GetSharedPool();
+
+  static const size_t SLAB_SIZE = 1024;
+  static const size_t BATCH_SIZE = 1024;
+
+  static thread_local ThreadPool pool;
+  static thread_local ThreadPoolReleaser releaser;
+};
+
+#include "node_pool_allocator_inl.h"
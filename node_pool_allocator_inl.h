@@ -0,0 +1,107 @@
+template<class T>
+thread_local typename NodePoolAllocator<T>::ThreadPool
+    NodePoolAllocator<T>::pool = {{nullptr, 0}, {nullptr, 0}, nullptr, nullptr};
+
+template<class T>
+thread_local typename NodePoolAllocator<T>::ThreadPoolReleaser
+    NodePoolAllocator<T>::releaser = {false};
+
+template<class T>
+NodePoolAllocator<T>::ThreadPoolReleaser::~ThreadPoolReleaser() {
+  if (pool.free_list.head != nullptr) {
+    ReleaseBatch(pool.free_list);
+  }
+  if (pool.full_batch.head != nullptr) {
+    ReleaseBatch(pool.full_batch);
+  }
+
+  // The rest of the current slab is released as well.
+  FreeList batch = {nullptr, 0};
+  for (; pool.slab_start != pool.slab_end; ++pool.slab_start) {
+    pool.slab_start->next = batch.head;
+    batch.head = pool.slab_start;
+    ++batch.size;
+  }
+  if (batch.head != nullptr) {
+    ReleaseBatch(batch);
+  }
+}
+
+template<class T>
+T* NodePoolAllocator<T>::allocate(size_t n, const void* hint) {
+  if (n != 1) {
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  if (pool.free_list.head == nullptr) {
+    if (pool.full_batch.head != nullptr) {
+      pool.free_list = pool.full_batch;
+      pool.full_batch.head = nullptr;
+      pool.full_batch.size = 0;
+    } else if (pool.slab_start == pool.slab_end) {
+      Refill(pool);
+    }
+  }
+
+  if (pool.free_list.head != nullptr) {
+    FreeNode* node = pool.free_list.head;
+    pool.free_list.head = node->next;
+    --pool.free_list.size;
+    return reinterpret_cast<T*>(node);
+  }
+
+  return reinterpret_cast<T*>(pool.slab_start++);
+}
+
+template<class T>
+void NodePoolAllocator<T>::deallocate(T* pointer, size_t n) {
+  if (n != 1) {
+    ::operator delete(pointer);
+    return;
+  }
+
+  FreeNode* node = reinterpret_cast<FreeNode*>(pointer);
+  node->next = pool.free_list.head;
+  pool.free_list.head = node;
+  if (++pool.free_list.size >= BATCH_SIZE) {
+    releaser.active = true;
+    if (pool.full_batch.head != nullptr) {
+      ReleaseBatch(pool.full_batch);
+    }
+    pool.full_batch = pool.free_list;
+    pool.free_list.head = nullptr;
+    pool.free_list.size = 0;
+  }
+}
+
+template<class T>
+void NodePoolAllocator<T>::ReleaseBatch(const FreeList& batch) {
+  SharedPool& shared_pool = GetSharedPool();
+  lock_guard<mutex> lock(shared_pool.lock);
+  shared_pool.batches.push_back(batch);
+}
+
+template<class T>
+void NodePoolAllocator<T>::Refill(ThreadPool& pool) {
+  releaser.active = true;
+  SharedPool& shared_pool = GetSharedPool();
+  {
+    lock_guard<mutex> lock(shared_pool.lock);
+    if (!shared_pool.batches.empty()) {
+      pool.free_list = shared_pool.batches.back();
+      shared_pool.batches.pop_back();
+      return;
+    }
+  }
+
+  pool.slab_start = static_cast<FreeNode*>(
+      ::operator new(SLAB_SIZE * sizeof(FreeNode)));
+  pool.slab_end = pool.slab_start + SLAB_SIZE;
+}
+
+template<class T>
+typename NodePoolAllocator<T>::SharedPool&
+    NodePoolAllocator<T>::GetSharedPool() {
+  static SharedPool* shared_pool = new SharedPool();
+  return *shared_pool;
+}
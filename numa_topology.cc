@@ -0,0 +1,123 @@
+#include "numa_topology.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const string NODE_DIRECTORY = "/sys/devices/system/node/";
+
+NumaStats::NumaStats() : local_allocations(0), remote_allocations(0) {}
+
+double NumaStats::GetRemoteAllocationFraction(
+    const NumaStats& previous) const {
+  long long local_delta = local_allocations - previous.local_allocations;
+  long long remote_delta = remote_allocations - previous.remote_allocations;
+  if (local_delta + remote_delta <= 0) {
+    return 0;
+  }
+  return (double) remote_delta / (local_delta + remote_delta);
+}
+
+NumaTopology::NumaTopology(int num_threads) : thread_nodes(num_threads) {
+  // The node ids are not necessarily contiguous, e.g. after hot-unplugging a
+  // node, so they are read from the list of online nodes.
+  ifstream online_stream(NODE_DIRECTORY + "online");
+  string online_list;
+  getline(online_stream, online_list);
+  for (int node_id: ParseList(online_list)) {
+    string node_path = NODE_DIRECTORY + "node" + to_string(node_id);
+    ifstream cpu_stream(node_path + "/cpulist");
+    string cpu_list;
+    getline(cpu_stream, cpu_list);
+    vector<int> cpus = ParseList(cpu_list);
+    // Skip memory-only nodes.
+    if (cpus.empty()) {
+      continue;
+    }
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu: cpus) {
+      CPU_SET(cpu, &cpu_set);
+    }
+    node_ids.push_back(node_id);
+    node_cpus.push_back(cpu_set);
+  }
+
+  if (node_ids.empty()) {
+    cerr << "WARNING: Unable to read the NUMA topology, "
+         << "assuming a single node" << endl;
+    cpu_set_t cpu_set;
+    sched_getaffinity(0, sizeof(cpu_set), &cpu_set);
+    node_ids.push_back(0);
+    node_cpus.push_back(cpu_set);
+  }
+
+  // Consecutive threads are assigned to the same node.
+  for (int i = 0; i < num_threads; ++i) {
+    thread_nodes[i] = (long long) i * node_ids.size() / num_threads;
+  }
+}
+
+vector<int> NumaTopology::ParseList(const string& list) {
+  // The format is a comma separated list of ranges.
+  vector<int> values;
+  istringstream iss(list);
+  string range;
+  while (getline(iss, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+
+    size_t dash = range.find('-');
+    int first = stoi(range.substr(0, dash));
+    int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+    for (int value = first; value <= last; ++value) {
+      values.push_back(value);
+    }
+  }
+
+  return values;
+}
+
+int NumaTopology::GetNumNodes() const {
+  return node_ids.size();
+}
+
+int NumaTopology::GetNode(int thread_id) const {
+  return thread_nodes[thread_id];
+}
+
+int NumaTopology::GetNumThreads(int node) const {
+  int num_threads = 0;
+  for (int thread_node: thread_nodes) {
+    num_threads += thread_node == node;
+  }
+  return num_threads;
+}
+
+void NumaTopology::PinThread(int thread_id) const {
+  const cpu_set_t& cpu_set = node_cpus[GetNode(thread_id)];
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    cerr << "WARNING: Unable to pin thread " << thread_id << endl;
+  }
+}
+
+NumaStats NumaTopology::GetStats() const {
+  NumaStats stats;
+  for (int node_id: node_ids) {
+    ifstream stats_stream(
+        NODE_DIRECTORY + "node" + to_string(node_id) + "/numastat");
+    string key;
+    long long value;
+    while (stats_stream >> key >> value) {
+      if (key == "local_node") {
+        stats.local_allocations += value;
+      } else if (key == "other_node") {
+        stats.remote_allocations += value;
+      }
+    }
+  }
+
+  return stats;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <sched.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Counters for the pages allocated on the local or on a remote NUMA node, as
+// reported by the kernel in numastat. The counters are system-wide and count
+// page allocations, not memory accesses.
+struct NumaStats {
+  NumaStats();
+
+  // The fraction of the pages allocated since the previous stats which were
+  // placed on a remote node.
+  double GetRemoteAllocationFraction(const NumaStats& previous) const;
+
+  long long local_allocations, remote_allocations;
+};
+
+// Assigns threads to NUMA nodes (sockets) and pins them to the CPUs of their
+// node. Falls back to a single node if the topology cannot be read from sysfs.
+class NumaTopology {
+ public:
+  NumaTopology(int num_threads);
+
+  int GetNumNodes() const;
+
+  int GetNode(int thread_id) const;
+
+  int GetNumThreads(int node) const;
+
+  // Restricts the calling thread to the CPUs of its NUMA node.
+  void PinThread(int thread_id) const;
+
+  NumaStats GetStats() const;
+
+ private:
+  // Parses the lists of CPUs or nodes used by sysfs, e.g. "0-7,16-23".
+  static vector<int> ParseList(const string& list);
+
+  vector<int> node_ids;
+  vector<cpu_set_t> node_cpus;
+  vector<int> thread_nodes;
+};
@@ -1,20 +1,72 @@
+#include <unistd.h>
+
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 
+#include <boost/asio.hpp>
 #include <boost/program_options.hpp>
 
 #include "aligned_tree.h"
 #include "dictionary.h"
 #include "grammar.h"
-#include "multi_sample_reorderer.h"
+#include "reorder_pipeline.h"
 #include "rule_stats_reporter.h"
 #include "time_util.h"
-#include "viterbi_reorderer.h"
 
 using namespace std;
 using namespace chrono;
+namespace asio = boost::asio;
 namespace po = boost::program_options;
+using asio::local::stream_protocol;
+
+void WriteRuleStats(const po::variables_map& vm,
+                    const shared_ptr<RuleStatsReporter>& reporter,
+                    Dictionary& dictionary) {
+  if (vm.count("stats_file")) {
+    cerr << "Writing grammar statistics..." << endl;
+    ofstream stats_stream(vm["stats_file"].as<string>());
+    reporter->DisplayRuleStats(stats_stream, dictionary);
+    cerr << "Done..." << endl;
+  }
+}
+
+// Serves the connections one at a time, until the process is killed. Every
+// connection sends parse trees and receives the reorderings, until it closes
+// its end of the socket. Since the process never exits normally, the grammar
+// statistics of all the connections so far are rewritten after each one.
+void ServeSocket(const string& path, ReorderPipeline& pipeline,
+                 int num_threads, int window_size,
+                 const po::variables_map& vm,
+                 const shared_ptr<RuleStatsReporter>& reporter,
+                 Dictionary& dictionary) {
+  asio::io_context io_context;
+  unlink(path.c_str());
+  stream_protocol::acceptor acceptor(
+      io_context, stream_protocol::endpoint(path));
+  cerr << "Listening on " << path << endl;
+  while (true) {
+    stream_protocol::iostream in_stream;
+    acceptor.accept(in_stream.socket());
+
+    // The reorderings are written by the worker threads while the trees are
+    // being read, so the two directions use separate streams.
+    stream_protocol::iostream out_stream;
+    out_stream.socket().assign(stream_protocol(),
+                               dup(in_stream.socket().native_handle()));
+
+    auto start_time = GetTime();
+    long long num_sentences =
+        pipeline.Run(in_stream, nullptr, out_stream, num_threads, window_size);
+    out_stream.flush();
+    auto stop_time = GetTime();
+    cerr << "Reordering " << num_sentences << " sentences took "
+         << GetDuration(start_time, stop_time) << " seconds..." << endl;
+
+    WriteRuleStats(vm, reporter, dictionary);
+  }
+}
 
 int main(int argc, char** argv) {
   po::options_description cmdline_specific("Command line options");
@@ -24,22 +76,39 @@ int main(int argc, char** argv) {
 
   po::options_description general_options("General options");
   general_options.add_options()
-      ("trees,t", po::value<string>()->required(),
+      ("trees,t", po::value<string>(),
           "Input parse trees to be reordered")
-      ("sentences", po::value<string>()->required(),
+      ("sentences", po::value<string>(),
           "SOURCE sentences used as a default for parse failures")
-      ("grammar,g", po::value<string>()->required(), "Path to grammar file")
-      ("alignment,a", po::value<string>()->required(),
+      ("grammar,g", po::value<string>(), "Path to grammar file")
+      ("alignment,a", po::value<string>(),
           "Path to file containing rule alignments")
+      ("compiled_grammar", po::value<string>(),
+          "Path to a grammar written by compile_grammar, used instead of "
+          "--grammar and --alignment. The threshold, penalty, max_leaves and "
+          "max_tree_size options are fixed when compiling the grammar.")
       ("threads", po::value<int>()->default_value(1)->required(),
           "Number of threads for reordering")
       ("iterations", po::value<unsigned int>()->default_value(0),
           "Number of samples to determine the reordering for each parse tree. "
           "If not set, a max-derivation reorderer will be used instead.")
+      ("kbest", po::value<int>()->default_value(0),
+          "Write the given number of best distinct reorderings of the "
+          "max-derivation reorderer for each parse tree, as lines of the form "
+          "'index ||| reordering ||| score'")
+      ("lattice", "With --kbest, write the reorderings of each parse tree as "
+          "a word lattice in the Python lattice format (PLF) instead")
       ("threshold", po::value<double>()->default_value(0)->required(),
           "Minimum probabilty for reodering rules")
       ("seed", po::value<unsigned int>()->default_value(0),
           "Seed for random generator. Set to 0 if seed should be random.")
+      ("early_stop", po::value<double>()->default_value(0),
+          "Stop sampling a parse tree once the lead of the most frequent "
+          "reordering over the runner-up is this many standard deviations "
+          "(e.g. 3). The lead is tested after every round of samples, so the "
+          "bound is raised with the number of rounds to keep the overall "
+          "false stop rate of a single test. If 0, all the --iterations "
+          "samples are drawn.")
       ("penalty", po::value<double>()->default_value(0.1)->required(),
           "Displacement penalty for reordering")
       ("max_leaves", po::value<int>()->default_value(5)->required(),
@@ -47,7 +116,18 @@ int main(int argc, char** argv) {
       ("max_tree_size", po::value<int>()->default_value(8)->required(),
           "Maximum size of a tree rule that is reordered")
       ("stats_file", po::value<string>(),
-          "Target file for writing stats about the reordering grammar");
+          "Target file for writing stats about the reordering grammar. "
+          "With --socket, rewritten after every connection.")
+      ("server", "Keep the grammar in memory and reorder the parse trees read "
+          "from stdin (or from the connections to --socket), one per line. A "
+          "tree may be followed by ' ||| ' and the source sentence used if the "
+          "tree is a parse failure. The reorderings are written in input order "
+          "as soon as they are ready.")
+      ("socket", po::value<string>(),
+          "Path of a Unix socket on which the server accepts connections, "
+          "served one at a time")
+      ("window", po::value<int>()->default_value(1000),
+          "Maximum number of trees held in memory");
 
   po::variables_map vm;
   po::options_description cmdline_options;
@@ -68,35 +148,54 @@ int main(int argc, char** argv) {
 
   po::notify(vm);
 
+  bool server_mode = vm.count("server");
+  if (!server_mode && (!vm.count("trees") || !vm.count("sentences"))) {
+    cerr << "Either --server or --trees and --sentences must be specified"
+         << endl;
+    return 1;
+  }
+
+  if (!vm.count("compiled_grammar") &&
+      (!vm.count("grammar") || !vm.count("alignment"))) {
+    cerr << "Either --compiled_grammar or --grammar and --alignment "
+         << "must be specified" << endl;
+    return 1;
+  }
+
+  int kbest_size = vm["kbest"].as<int>();
+  if (kbest_size > 0 && vm["iterations"].as<unsigned int>() > 0) {
+    cerr << "--kbest cannot be combined with --iterations" << endl;
+    return 1;
+  }
+  if (vm.count("lattice") && kbest_size <= 0) {
+    cerr << "--lattice requires --kbest" << endl;
+    return 1;
+  }
+  if (vm["window"].as<int>() <= 0) {
+    cerr << "--window must be positive" << endl;
+    return 1;
+  }
+
   auto start_time = GetTime();
-  cerr << "Constructing reordering grammar..." << endl;
   Dictionary dictionary;
-  ifstream grammar_stream(vm["grammar"].as<string>());
-  ifstream alignment_stream(vm["alignment"].as<string>());
-  Grammar grammar(grammar_stream, alignment_stream, dictionary,
-                  vm["penalty"].as<double>(), vm["threshold"].as<double>(),
-                  vm["max_leaves"].as<int>(), vm["max_tree_size"].as<int>());
+  shared_ptr<Grammar> grammar;
+  if (vm.count("compiled_grammar")) {
+    cerr << "Loading compiled reordering grammar..." << endl;
+    grammar = make_shared<Grammar>(
+        vm["compiled_grammar"].as<string>(), dictionary);
+  } else {
+    cerr << "Constructing reordering grammar..." << endl;
+    ifstream grammar_stream(vm["grammar"].as<string>());
+    ifstream alignment_stream(vm["alignment"].as<string>());
+    grammar = make_shared<Grammar>(
+        grammar_stream, alignment_stream, dictionary,
+        vm["penalty"].as<double>(), vm["threshold"].as<double>(),
+        vm["max_leaves"].as<int>(), vm["max_tree_size"].as<int>());
+  }
   auto stop_time = GetTime();
   cerr << "Constructing grammar took " << GetDuration(start_time, stop_time)
        << " seconds..." << endl;
 
-  cerr << "Reading parse trees..." << endl;
-  ifstream tree_stream(vm["trees"].as<string>());
-  vector<AlignedTree> input_trees;
-  while (!tree_stream.eof()) {
-    input_trees.push_back(ReadParseTree(tree_stream, dictionary));
-    tree_stream >> ws;
-  }
-  cerr << "Done..." << endl;
-
-  cerr << "Reading source sentences..." << endl;
-  ifstream sentence_stream(vm["sentences"].as<string>());
-  vector<String> source_sentences;
-  while (!sentence_stream.eof()) {
-    source_sentences.push_back(ReadTargetString(sentence_stream, dictionary));
-    sentence_stream >> ws;
-  }
-
   unsigned int num_iterations = 0;
   if (vm.count("iterations")) {
     num_iterations = vm["iterations"].as<unsigned int>();
@@ -104,66 +203,44 @@ int main(int argc, char** argv) {
   if (num_iterations > 0) {
     cerr << "Using sampling-based reordering with " << num_iterations
          << " iterations..." << endl;
+  } else if (kbest_size > 0) {
+    cerr << "Using " << kbest_size << "-best max-derivation reorderer..."
+         << endl;
   } else {
     cerr << "Using max-derivation (Viterbi) reorderer..." << endl;
   }
 
-  int sentence_index = 0;
-  start_time = GetTime();
   shared_ptr<RuleStatsReporter> reporter = make_shared<RuleStatsReporter>();
-  vector<String> reorderings(input_trees.size());
+  ReorderPipeline pipeline(*grammar, dictionary, reporter, num_iterations,
+                           vm["seed"].as<unsigned int>(),
+                           vm["early_stop"].as<double>(), kbest_size,
+                           vm.count("lattice"));
   int num_threads = vm["threads"].as<int>();
   cerr << "Reordering will use " << num_threads << " threads." << endl;
-  #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
-  for (size_t i = 0; i < input_trees.size(); ++i) {
-    // Ignore unparsable sentences.
-    if (input_trees[i].size() <= 1) {
-      reorderings[i] = source_sentences[i];
-    } else {
-      shared_ptr<ReordererBase> reorderer;
-      if (num_iterations) {
-        unsigned int seed = vm["seed"].as<unsigned int>();
-        if (seed == 0) {
-          seed = time(NULL);
-        }
-        RandomGenerator generator(seed);
-        reorderer = make_shared<MultiSampleReorderer>(
-            input_trees[i], grammar, reporter, generator, num_iterations);
-      } else {
-        reorderer = make_shared<ViterbiReorderer>(
-            input_trees[i], grammar, reporter);
-      }
-      reorderings[i] = reorderer->ConstructReordering();
-    }
 
-    #pragma omp critical
-    {
-      ++sentence_index;
-      if (sentence_index % 10 == 0) {
-        cerr << ".";
-        if (sentence_index % 1000 == 0) {
-          cerr << " [" << sentence_index << "]" << endl;
-        }
-      }
+  int window_size = vm["window"].as<int>();
+  if (server_mode && vm.count("socket")) {
+    ServeSocket(vm["socket"].as<string>(), pipeline, num_threads,
+                window_size, vm, reporter, dictionary);
+  } else {
+    long long num_sentences;
+    start_time = GetTime();
+    if (server_mode) {
+      cerr << "Reading parse trees from stdin..." << endl;
+      num_sentences =
+          pipeline.Run(cin, nullptr, cout, num_threads, window_size);
+    } else {
+      ifstream tree_stream(vm["trees"].as<string>());
+      ifstream sentence_stream(vm["sentences"].as<string>());
+      num_sentences = pipeline.Run(tree_stream, &sentence_stream, cout,
+                                   num_threads, window_size, true);
     }
+    stop_time = GetTime();
+    cerr << "Reordering " << num_sentences << " sentences took "
+         << GetDuration(start_time, stop_time) << " seconds..." << endl;
   }
-  stop_time = GetTime();
-  cerr << endl << "Reordering " << reorderings.size() << " sentences took "
-       << GetDuration(start_time, stop_time) << " seconds..." << endl;
-
-  cerr << "Writing reordered sentences..." << endl;
-  for (String reordering: reorderings) {
-    WriteTargetString(cout, reordering, dictionary);
-    cout << "\n";
-  }
-  cerr << "Done..." << endl;
 
-  if (vm.count("stats_file")) {
-    cerr << "Writing grammar statistics..." << endl;
-    ofstream stats_stream(vm["stats_file"].as<string>());
-    reporter->DisplayRuleStats(stats_stream, dictionary);
-    cerr << "Done..." << endl;
-  }
+  WriteRuleStats(vm, reporter, dictionary);
 
   return 0;
 }
@@ -0,0 +1,207 @@
+#include "reorder_pipeline.h"
+
+#include <omp.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+
+#include "dictionary.h"
+#include "grammar.h"
+#include "kbest_reorderer.h"
+#include "multi_sample_reorderer.h"
+#include "reordering_lattice.h"
+#include "util.h"
+#include "viterbi_reorderer.h"
+
+static const string SENTENCE_SEPARATOR = "|||";
+
+ReorderPipeline::ReorderPipeline(const Grammar& grammar,
+                                 Dictionary& dictionary,
+                                 shared_ptr<RuleStatsReporter> reporter,
+                                 unsigned int num_iterations,
+                                 unsigned int seed,
+                                 double early_stop,
+                                 int kbest_size,
+                                 bool write_lattice) :
+    grammar(grammar), dictionary(dictionary), reporter(reporter),
+    num_iterations(num_iterations), seed(seed), early_stop(early_stop),
+    kbest_size(kbest_size), write_lattice(write_lattice) {
+  if (this->seed == 0) {
+    this->seed = random_device()();
+  }
+}
+
+String ReorderPipeline::Reorder(const AlignedTree& tree,
+                                const String& source_sentence,
+                                long long index) const {
+  // Ignore unparsable sentences.
+  if (tree.size() <= 1) {
+    return source_sentence;
+  }
+
+  shared_ptr<ReordererBase> reorderer;
+  if (num_iterations) {
+    seed_seq sentence_seed{seed, (unsigned int) index,
+                           (unsigned int) (index >> 32)};
+    unsigned int sentence_stream;
+    sentence_seed.generate(&sentence_stream, &sentence_stream + 1);
+    reorderer = make_shared<MultiSampleReorderer>(
+        tree, grammar, reporter, sentence_stream, num_iterations, early_stop);
+  } else {
+    reorderer = make_shared<ViterbiReorderer>(tree, grammar, reporter);
+  }
+  return reorderer->ConstructReordering();
+}
+
+vector<pair<String, double>> ReorderPipeline::ReorderKBest(
+    const AlignedTree& tree, const String& source_sentence) const {
+  if (tree.size() <= 1) {
+    return vector<pair<String, double>>(1, make_pair(source_sentence, 0.0));
+  }
+
+  KBestReorderer reorderer(tree, grammar, reporter);
+  return reorderer.ConstructReorderings(kbest_size);
+}
+
+void ReorderPipeline::ReadRequest(
+    const string& line, istream* sentence_stream, mutex& lock,
+    AlignedTree& tree, String& source_sentence) const {
+  string tree_line = line, sentence_line;
+  if (sentence_stream != nullptr) {
+    getline(*sentence_stream, sentence_line);
+  } else {
+    size_t separator = line.find(SENTENCE_SEPARATOR);
+    if (separator != string::npos) {
+      tree_line = line.substr(0, separator);
+      sentence_line = line.substr(separator + SENTENCE_SEPARATOR.size());
+    }
+  }
+
+  // The request is parsed with its own dictionary, so that the shared
+  // dictionary is only locked for looking up the indexes of its tokens.
+  Dictionary request_dictionary;
+  istringstream tree_stream(tree_line);
+  tree = ReadParseTree(tree_stream, request_dictionary);
+  istringstream sentence_line_stream(sentence_line);
+  source_sentence = ReadTargetString(sentence_line_stream, request_dictionary);
+
+  vector<int> indexes(request_dictionary.GetSize());
+  {
+    lock_guard<mutex> guard(lock);
+    for (size_t i = 0; i < indexes.size(); ++i) {
+      indexes[i] = dictionary.GetIndex(request_dictionary.GetToken(i));
+    }
+  }
+
+  for (auto& node: tree) {
+    if (node.IsSetTag()) {
+      node.SetTag(indexes[node.GetTag()]);
+    }
+    if (node.IsSetWord()) {
+      node.SetWord(indexes[node.GetWord()]);
+    }
+  }
+  for (auto& node: source_sentence) {
+    if (node.IsSetWord()) {
+      node = StringNode(indexes[node.GetWord()], node.GetWordIndex(), -1);
+    }
+  }
+}
+
+void ReorderPipeline::WriteReorderings(
+    ostream& out, long long index,
+    const vector<pair<String, double>>& reorderings) const {
+  if (kbest_size == 0) {
+    WriteTargetString(out, reorderings.front().first, dictionary);
+    out << "\n";
+  } else if (write_lattice) {
+    ReorderingLattice(reorderings).WritePLF(out, dictionary);
+    out << "\n";
+  } else {
+    for (const auto& reordering: reorderings) {
+      out << index << " ||| ";
+      WriteTargetString(out, reordering.first, dictionary);
+      out << "||| " << reordering.second << "\n";
+    }
+  }
+}
+
+long long ReorderPipeline::Run(
+    istream& tree_stream, istream* sentence_stream, ostream& out,
+    int num_threads, int window_size, bool batch_mode) {
+  // The dictionary is extended by the reader while the reorderings are
+  // written, so both the lookups of the reader and the writes happen under
+  // the lock.
+  mutex lock;
+  // Signaled whenever reorderings are written, which frees slots in the
+  // window.
+  condition_variable written_condition;
+  map<long long, vector<pair<String, double>>> ready;
+  long long num_read = 0, num_written = 0;
+
+  #pragma omp parallel num_threads(num_threads)
+  #pragma omp single
+  {
+    // A single thread would not get to run deferred tasks while the reader
+    // waits for input or for a slot in the window.
+    bool defer_tasks = omp_get_num_threads() > 1;
+    string line;
+    while (getline(tree_stream, line)) {
+      AlignedTree tree;
+      String source_sentence;
+      ReadRequest(line, sentence_stream, lock, tree, source_sentence);
+      {
+        unique_lock<mutex> guard(lock);
+        written_condition.wait(guard, [&]() {
+          return num_read - num_written < window_size;
+        });
+      }
+      long long index = num_read++;
+
+      #pragma omp task firstprivate(index, tree, source_sentence) \
+          if(defer_tasks)
+      {
+        vector<pair<String, double>> reorderings;
+        if (kbest_size > 0) {
+          reorderings = ReorderKBest(tree, source_sentence);
+        } else {
+          reorderings.push_back(
+              make_pair(Reorder(tree, source_sentence, index), 0.0));
+        }
+
+        lock_guard<mutex> guard(lock);
+        ready[index] = move(reorderings);
+        bool written = false;
+        while (!ready.empty() && ready.begin()->first == num_written) {
+          WriteReorderings(out, num_written, ready.begin()->second);
+          ready.erase(ready.begin());
+          ++num_written;
+          written = true;
+
+          if (batch_mode && num_written % 10 == 0) {
+            cerr << ".";
+            if (num_written % 1000 == 0) {
+              cerr << " [" << num_written << "]" << endl;
+            }
+          }
+        }
+        if (written) {
+          if (!batch_mode) {
+            out.flush();
+          }
+          written_condition.notify_one();
+        }
+      }
+    }
+
+    #pragma omp taskwait
+  }
+
+  if (batch_mode) {
+    cerr << endl;
+  }
+  return num_read;
+}
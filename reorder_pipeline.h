@@ -0,0 +1,72 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "definitions.h"
+
+using namespace std;
+
+class Dictionary;
+class Grammar;
+class RuleStatsReporter;
+
+// Reorders a stream of parse trees in parallel. Every tree is reordered in an
+// OpenMP task and the reorderings are written in input order, each one as soon
+// as it and all the reorderings before it are ready. At most a window of trees
+// is in flight at any time.
+class ReorderPipeline {
+ public:
+  // If the number of iterations is 0, the max-derivation reorderer is used.
+  // If the seed is 0, a seed is drawn from the random device. Every sentence
+  // is sampled with its own random streams, derived from the seed and the
+  // index of the sentence. See MultiSampleReorderer for early_stop. If
+  // kbest_size is positive, the kbest_size best distinct reorderings of the
+  // max-derivation reorderer are written instead of a single reordering, as
+  // an n-best list or as a word lattice.
+  ReorderPipeline(const Grammar& grammar,
+                  Dictionary& dictionary,
+                  shared_ptr<RuleStatsReporter> reporter,
+                  unsigned int num_iterations,
+                  unsigned int seed,
+                  double early_stop = 0,
+                  int kbest_size = 0,
+                  bool write_lattice = false);
+
+  // Trees which could not be parsed are replaced by the source sentence.
+  String Reorder(const AlignedTree& tree, const String& source_sentence,
+                 long long index) const;
+
+  // Returns the reorderings with the log probabilities of their derivations,
+  // best first.
+  vector<pair<String, double>> ReorderKBest(
+      const AlignedTree& tree, const String& source_sentence) const;
+
+  // Reads one parse tree per line. The source sentences are read from the
+  // sentence stream, one per line, or follow the trees on the same line after
+  // " ||| " if there is no sentence stream. Unless in batch mode, the output is
+  // flushed whenever new reorderings are written. In batch mode, the progress
+  // is displayed instead. The window size must be positive. Returns the
+  // number of reordered trees.
+  long long Run(istream& tree_stream, istream* sentence_stream, ostream& out,
+                int num_threads, int window_size, bool batch_mode = false);
+
+ private:
+  // Only holds the lock while adding the tokens to the dictionary.
+  void ReadRequest(const string& line, istream* sentence_stream, mutex& lock,
+                   AlignedTree& tree, String& source_sentence) const;
+
+  void WriteReorderings(ostream& out, long long index,
+                        const vector<pair<String, double>>& reorderings) const;
+
+  const Grammar& grammar;
+  Dictionary& dictionary;
+  shared_ptr<RuleStatsReporter> reporter;
+  unsigned int num_iterations;
+  unsigned int seed;
+  double early_stop;
+  int kbest_size;
+  bool write_lattice;
+};
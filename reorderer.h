@@ -2,20 +2,26 @@
 #define _REORDERER_H_
 
 #include <chrono>
-#include <map>
+#include <vector>
 
 #include "grammar.h"
+#include "indexed_tree.h"
 #include "reorderer_base.h"
 #include "rule_matcher.h"
+#include "semiring.h"
 
 using namespace std;
 using namespace chrono;
 
-typedef map<NodeIter, double> Cache;
 typedef high_resolution_clock Clock;
 
 class RuleStatsReporter;
 
+// Computes the inside values of all the tree nodes bottom-up in the given
+// semiring (see semiring.h) and builds a reordering top-down from the rules
+// chosen by SelectRule. The semiring is fixed at compile time, so that the
+// loop over the matches does not go through virtual calls.
+template<class Semiring>
 class Reorderer : public ReordererBase {
  public:
   Reorderer(
@@ -26,24 +32,48 @@ class Reorderer : public ReordererBase {
   String ConstructReordering();
 
  protected:
-  void ConstructProbabilityCache();
+  typedef typename Semiring::Value Value;
 
-  virtual void Combine(double& cache_prob, double match_prob) = 0;
+  // Returns the index of the match of the node to apply, or -1 if no rule
+  // matches the node. Sets match_prob to the score of the selected match.
+  virtual int SelectRule(int node, double& match_prob) = 0;
 
- private:
-  void ConstructReordering(const NodeIter& tree_node, String& reordering);
+  // Builds a reordering with the matches chosen by select(node, match_prob),
+  // which works like SelectRule. Safe to call from several threads if select
+  // is.
+  template<class Selector>
+  String ConstructReordering(Selector& select) const;
+
+  // The scores of the matches of the node, including the inside scores of
+  // their frontier nodes.
+  vector<double> GetMatchProbs(int node) const;
 
-  shared_ptr<pair<Rule, double>> SelectRule(const NodeIter& node);
+  const Value& GetInsideValue(int node) const;
 
-  virtual shared_ptr<pair<Rule, double>> SelectRule(
-      const vector<pair<Rule, double>>& candidates) = 0;
+  const IndexedTree& GetTree() const;
 
+  const RuleMatcher& GetMatcher() const;
+
+  // The score of keeping the children of a node without matching rules in
+  // order.
   static const double NO_MATCH;
 
-  AlignedTree tree;
+ private:
+  void ConstructProbabilityCache();
+
+  template<class Selector>
+  void ConstructReordering(int tree_node, Selector& select,
+                           String& reordering) const;
+
+  double GetMatchProb(int node, const FragmentMatch& match) const;
+
+  IndexedTree tree;
   RuleMatcher matcher;
   shared_ptr<RuleStatsReporter> reporter;
-  Cache cache;
+  // Inside values, indexed by the preorder ids of the tree nodes.
+  vector<Value> cache;
 };
 
+#include "reorderer_inl.h"
+
 #endif
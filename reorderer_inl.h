@@ -0,0 +1,126 @@
+#include "rule_stats_reporter.h"
+
+template<class Semiring>
+const double Reorderer<Semiring>::NO_MATCH = -1e3;
+
+template<class Semiring>
+Reorderer<Semiring>::Reorderer(
+    const AlignedTree& tree,
+    const Grammar& grammar,
+    shared_ptr<RuleStatsReporter> reporter) :
+    tree(tree), matcher(grammar, this->tree), reporter(reporter),
+    cache(this->tree.GetSize(), Semiring::Zero()) {
+  ConstructProbabilityCache();
+}
+
+template<class Semiring>
+void Reorderer<Semiring>::ConstructProbabilityCache() {
+  // The children of a node have larger ids than the node itself, so they are
+  // scored first.
+  for (int node = tree.GetSize() - 1; node >= 0; --node) {
+    const auto& matches = matcher.GetRules(node);
+    if (matches.size() > 0) {
+      for (size_t i = 0; i < matches.size(); ++i) {
+        Semiring::Plus(cache[node], Semiring::FromMatch(
+            GetMatchProb(node, matches[i]), i));
+      }
+    } else {
+      double match_prob = NO_MATCH;
+      for (int child: tree.GetChildren(node)) {
+        match_prob += Semiring::GetScore(cache[child]);
+      }
+      Semiring::Plus(cache[node], Semiring::FromMatch(match_prob, -1));
+    }
+  }
+}
+
+template<class Semiring>
+String Reorderer<Semiring>::ConstructReordering() {
+  auto select = [this](int node, double& match_prob) {
+    return SelectRule(node, match_prob);
+  };
+  return ConstructReordering(select);
+}
+
+template<class Semiring>
+template<class Selector>
+String Reorderer<Semiring>::ConstructReordering(Selector& select) const {
+  String reordering;
+  ConstructReordering(0, select, reordering);
+  for (size_t i = 0; i < reordering.size(); ++i) {
+    reordering[i].SetWordIndex(i);
+  }
+  return reordering;
+}
+
+template<class Semiring>
+template<class Selector>
+void Reorderer<Semiring>::ConstructReordering(
+    int tree_node, Selector& select, String& reordering) const {
+  double match_prob;
+  int match_index = select(tree_node, match_prob);
+  if (match_index == -1) {
+    if (tree.GetNumChildren(tree_node) == 0) {
+      // Unknown terminal: Not much to do about it, simply return it as is.
+      reordering.push_back(StringNode(tree.GetWord(tree_node), -1, -1));
+    } else {
+      // Unknown interior rule: No reordering is applied.
+      for (int child: tree.GetChildren(tree_node)) {
+        ConstructReordering(child, select, reordering);
+      }
+    }
+    return;
+  }
+
+  const FragmentMatch& match = matcher.GetRules(tree_node)[match_index];
+  const Rule& rule = matcher.GetRule(tree_node, match).first;
+  reporter->UpdateRuleStats(rule, match_prob);
+
+  const int* frontier = matcher.GetFrontier(match);
+  const String& reordered_frontier = rule.second;
+  for (const auto& node: reordered_frontier) {
+    if (node.IsSetWord()) {
+      reordering.push_back(node);
+    } else {
+      ConstructReordering(frontier[node.GetVarIndex()], select, reordering);
+    }
+  }
+}
+
+template<class Semiring>
+double Reorderer<Semiring>::GetMatchProb(
+    int node, const FragmentMatch& match) const {
+  double match_prob = matcher.GetRule(node, match).second;
+  const int* frontier = matcher.GetFrontier(match);
+  for (int i = 0; i < match.num_frontier; ++i) {
+    match_prob += Semiring::GetScore(cache[frontier[i]]);
+  }
+  return match_prob;
+}
+
+template<class Semiring>
+vector<double> Reorderer<Semiring>::GetMatchProbs(int node) const {
+  const auto& matches = matcher.GetRules(node);
+  vector<double> match_probs;
+  match_probs.reserve(matches.size());
+  for (const auto& match: matches) {
+    match_probs.push_back(GetMatchProb(node, match));
+  }
+  return match_probs;
+}
+
+template<class Semiring>
+const typename Semiring::Value& Reorderer<Semiring>::GetInsideValue(
+    int node) const {
+  return cache[node];
+}
+
+template<class Semiring>
+const IndexedTree& Reorderer<Semiring>::GetTree() const {
+  return tree;
+}
+
+template<class Semiring>
+const RuleMatcher& Reorderer<Semiring>::GetMatcher() const {
+  return matcher;
+}
@@ -0,0 +1,144 @@
+#include "reordering_lattice.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+#include "dictionary.h"
+#include "log_add.h"
+
+bool ReorderingLattice::Edge::operator<(const Edge& other) const {
+  if (word != other.word) {
+    return word < other.word;
+  }
+  if (prob != other.prob) {
+    return prob < other.prob;
+  }
+  return target < other.target;
+}
+
+// Writes the word as a quoted Python string.
+static void WritePLFWord(ostream& out, const string& word) {
+  out << "'";
+  for (char c: word) {
+    if (c == '\'' || c == '\\') {
+      out << "\\";
+    }
+    out << c;
+  }
+  out << "'";
+}
+
+ReorderingLattice::ReorderingLattice(
+    const vector<pair<String, double>>& reorderings) {
+  double total_score = Log<double>::zero();
+  for (const auto& reordering: reorderings) {
+    total_score = Log<double>::add(total_score, reordering.second);
+  }
+
+  // Prefix tree over the reorderings. The children of a state are always
+  // created after it. The masses are kept as log probabilities, since the
+  // probabilities of the worse reorderings may underflow.
+  vector<map<int, int>> children(1);
+  vector<double> masses(1, Log<double>::zero());
+  vector<double> end_masses(1, Log<double>::zero());
+  // Reorderings so unlikely that their probability underflows are left out,
+  // since the probabilities of the edges only used by them would be 0.
+  double min_score = log(numeric_limits<double>::min());
+  for (const auto& reordering: reorderings) {
+    double score = reordering.second - total_score;
+    if (score < min_score) {
+      continue;
+    }
+    int state = 0;
+    masses[state] = Log<double>::add(masses[state], score);
+    for (const auto& node: reordering.first) {
+      auto result = children[state].insert(
+          make_pair(node.GetWord(), (int) children.size()));
+      if (result.second) {
+        children.push_back(map<int, int>());
+        masses.push_back(Log<double>::zero());
+        end_masses.push_back(Log<double>::zero());
+      }
+      state = result.first->second;
+      masses[state] = Log<double>::add(masses[state], score);
+    }
+    end_masses[state] = Log<double>::add(end_masses[state], score);
+  }
+
+  // Merges the states bottom-up into the nodes with the same outgoing edges.
+  // The final node is the only node without outgoing edges.
+  vector<vector<Edge>> merged_nodes;
+  map<vector<Edge>, int> node_indexes;
+  vector<int> state_nodes(children.size());
+  int final_node = -1;
+  for (int state = children.size() - 1; state >= 0; --state) {
+    vector<Edge> edges;
+    for (const auto& child: children[state]) {
+      Edge edge;
+      edge.word = child.first;
+      edge.prob = exp(masses[child.second] - masses[state]);
+      edge.target = state_nodes[child.second];
+      edges.push_back(edge);
+    }
+    if (!edges.empty() && end_masses[state] != Log<double>::zero()) {
+      if (final_node == -1) {
+        final_node = merged_nodes.size();
+        node_indexes[vector<Edge>()] = final_node;
+        merged_nodes.push_back(vector<Edge>());
+      }
+      Edge edge;
+      edge.word = -1;
+      edge.prob = exp(end_masses[state] - masses[state]);
+      edge.target = final_node;
+      edges.push_back(edge);
+    }
+    sort(edges.begin(), edges.end());
+
+    auto result = node_indexes.insert(make_pair(edges, merged_nodes.size()));
+    if (result.second) {
+      if (edges.empty()) {
+        final_node = merged_nodes.size();
+      }
+      merged_nodes.push_back(edges);
+    }
+    state_nodes[state] = result.first->second;
+  }
+
+  // Every node is created after the nodes its edges lead to, so reversing the
+  // order of creation sorts them topologically, with the final node last
+  // unless it was created first.
+  int num_nodes = merged_nodes.size();
+  vector<int> order(num_nodes);
+  int position = 0;
+  for (int node = num_nodes - 1; node >= 0; --node) {
+    if (node != final_node) {
+      order[node] = position++;
+    }
+  }
+  order[final_node] = position;
+
+  nodes.resize(num_nodes);
+  for (int node = 0; node < num_nodes; ++node) {
+    for (Edge edge: merged_nodes[node]) {
+      edge.target = order[edge.target];
+      nodes[order[node]].push_back(edge);
+    }
+  }
+}
+
+void ReorderingLattice::WritePLF(ostream& out, Dictionary& dictionary) const {
+  out << "(";
+  for (size_t node = 0; node + 1 < nodes.size(); ++node) {
+    out << "(";
+    for (const auto& edge: nodes[node]) {
+      out << "(";
+      WritePLFWord(out, edge.word == -1 ? "*EPS*" :
+                                          dictionary.GetToken(edge.word));
+      out << "," << edge.prob << "," << edge.target - node << "),";
+    }
+    out << "),";
+  }
+  out << ")";
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include "definitions.h"
+
+using namespace std;
+
+class Dictionary;
+
+// Word lattice over alternative reorderings of a sentence. The reorderings
+// are merged in a prefix tree, whose states with identical futures (the same
+// words and probabilities leading to the same states) are then merged as
+// well, so that both the prefixes and the suffixes shared by the reorderings
+// are only stored once. The probability of a path is the probability of its
+// reordering, normalized over all the reorderings. Reorderings whose normalized
+// probability is below the smallest normal double are left out, so that every
+// edge has a positive probability.
+class ReorderingLattice {
+ public:
+  // The scores are log probabilities.
+  ReorderingLattice(const vector<pair<String, double>>& reorderings);
+
+  // Writes the lattice on a single line in the Python lattice format read by
+  // Moses. The final node is implicit.
+  void WritePLF(ostream& out, Dictionary& dictionary) const;
+
+ private:
+  struct Edge {
+    bool operator<(const Edge& other) const;
+
+    // -1 for epsilon edges, from the nodes where a reordering ends although
+    // longer ones go on.
+    int word;
+    double prob;
+    int target;
+  };
+
+  // The nodes in topological order, such that the edges always lead to a
+  // later node. The last node is the final node.
+  vector<vector<Edge>> nodes;
+};
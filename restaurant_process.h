@@ -9,7 +9,7 @@ class RestaurantProcess {
  public:
   RestaurantProcess(double alpha = 0);
 
-  map<Table, int> Get() const;
+  const map<Table, int>& Get() const;
 
   void Update(const Table& table, int value);
 
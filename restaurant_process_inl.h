@@ -7,7 +7,7 @@ RestaurantProcess<Table>::RestaurantProcess(double alpha) :
     alpha(alpha), log_alpha(log(alpha)), total_count(0) {}
 
 template<class Table>
-map<Table, int> RestaurantProcess<Table>::Get() const {
+const map<Table, int>& RestaurantProcess<Table>::Get() const {
   return table_counts;
 }
 
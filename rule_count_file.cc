@@ -0,0 +1,150 @@
+#include "rule_count_file.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "aligned_tree.h"
+#include "binary_io.h"
+#include "dictionary.h"
+
+static const string MAGIC = "WORMRC01";
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static void UpdateFingerprint(uint64_t& fingerprint, int32_t value) {
+  uint32_t bytes = value;
+  for (int i = 0; i < 4; ++i) {
+    fingerprint ^= bytes & 0xFF;
+    fingerprint *= FNV_PRIME;
+    bytes >>= 8;
+  }
+}
+
+bool RuleCountEntry::operator<(const RuleCountEntry& entry) const {
+  if (fingerprint != entry.fingerprint) {
+    return fingerprint < entry.fingerprint;
+  }
+  return rule < entry.rule;
+}
+
+bool RuleCountEntry::operator==(const RuleCountEntry& entry) const {
+  return fingerprint == entry.fingerprint && rule == entry.rule;
+}
+
+uint64_t GetRuleFingerprint(const Rule& rule) {
+  // Only the fields used for comparing rules are included.
+  uint64_t fingerprint = FNV_OFFSET;
+  const AlignedTree& frag = rule.first;
+  for (auto node = frag.begin(); node != frag.end(); ++node) {
+    UpdateFingerprint(fingerprint, node->GetTag());
+    UpdateFingerprint(fingerprint, node->GetWord());
+    UpdateFingerprint(fingerprint, node.number_of_children());
+  }
+
+  for (const auto& node: rule.second) {
+    UpdateFingerprint(fingerprint, node.GetWord());
+    UpdateFingerprint(fingerprint, node.GetVarIndex());
+  }
+
+  return fingerprint;
+}
+
+uint64_t GetDictionaryFingerprint(Dictionary& dictionary) {
+  uint64_t fingerprint = FNV_OFFSET;
+  UpdateFingerprint(fingerprint, dictionary.GetSize());
+  for (int i = 0; i < dictionary.GetSize(); ++i) {
+    string token = dictionary.GetToken(i);
+    UpdateFingerprint(fingerprint, token.size());
+    for (char c: token) {
+      UpdateFingerprint(fingerprint, (unsigned char) c);
+    }
+  }
+
+  return fingerprint;
+}
+
+void WriteRuleCountFile(const string& filename, const RuleCounts& counts,
+                        Dictionary& dictionary) {
+  vector<pair<uint64_t, pair<const Rule*, int>>> entries;
+  for (const auto& entry: counts) {
+    for (const auto& rule_entry: entry.second.Get()) {
+      entries.push_back(make_pair(GetRuleFingerprint(rule_entry.first),
+                                  make_pair(&rule_entry.first,
+                                            rule_entry.second)));
+    }
+  }
+
+  sort(entries.begin(), entries.end(),
+      [](const pair<uint64_t, pair<const Rule*, int>>& entry1,
+         const pair<uint64_t, pair<const Rule*, int>>& entry2) -> bool {
+        if (entry1.first != entry2.first) {
+          return entry1.first < entry2.first;
+        }
+        return *entry1.second.first < *entry2.second.first;
+      });
+
+  RuleCountWriter writer(filename, dictionary);
+  RuleCountEntry entry;
+  for (const auto& sorted_entry: entries) {
+    entry.fingerprint = sorted_entry.first;
+    entry.rule = *sorted_entry.second.first;
+    entry.count = sorted_entry.second.second;
+    writer.Write(entry);
+  }
+}
+
+RuleCountWriter::RuleCountWriter(
+    const string& filename, Dictionary& dictionary) :
+    out(filename, ios::binary) {
+  out.write(MAGIC.data(), MAGIC.size());
+  WriteBinary<int32_t>(out, dictionary.GetSize());
+  for (int i = 0; i < dictionary.GetSize(); ++i) {
+    string token = dictionary.GetToken(i);
+    WriteBinary<int32_t>(out, token.size());
+    out.write(token.data(), token.size());
+  }
+}
+
+void RuleCountWriter::Write(const RuleCountEntry& entry) {
+  WriteBinary<uint64_t>(out, entry.fingerprint);
+  WriteBinary<int64_t>(out, entry.count);
+  WriteBinaryRule(out, entry.rule);
+}
+
+RuleCountReader::RuleCountReader(
+    const string& filename, Dictionary& dictionary) :
+    in(filename, ios::binary) {
+  string magic(MAGIC.size(), ' ');
+  in.read(&magic[0], magic.size());
+  if (!in || magic != MAGIC) {
+    cerr << filename << " is not a rule count file" << endl;
+    exit(1);
+  }
+
+  int32_t num_tokens;
+  ReadBinary(in, num_tokens);
+  for (int i = 0; i < num_tokens; ++i) {
+    int32_t length;
+    ReadBinary(in, length);
+    string token(length, ' ');
+    in.read(&token[0], length);
+    if (dictionary.GetIndex(token) != i) {
+      cerr << "The dictionary of " << filename << " does not match" << endl;
+      exit(1);
+    }
+  }
+}
+
+bool RuleCountReader::Next(RuleCountEntry& entry) {
+  ReadBinary(in, entry.fingerprint);
+  if (!in) {
+    return false;
+  }
+
+  ReadBinary(in, entry.count);
+  entry.rule = ReadBinaryRule(in);
+  return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "distributed_rule_counts.h"
+
+using namespace std;
+
+class Dictionary;
+
+// Binary files containing rule counts. The entries are sorted by the
+// fingerprint of the rule (and by the rule itself if the fingerprints collide),
+// so that several files can be merged in a single streaming pass. The files
+// start with the dictionary used for encoding the rules.
+
+struct RuleCountEntry {
+  bool operator<(const RuleCountEntry& entry) const;
+
+  bool operator==(const RuleCountEntry& entry) const;
+
+  uint64_t fingerprint;
+  Rule rule;
+  int64_t count;
+};
+
+// Returns a hash of the rule which does not depend on the platform or on the
+// library versions. Rules comparing equal have equal fingerprints.
+uint64_t GetRuleFingerprint(const Rule& rule);
+
+// Returns a hash of the tokens of the dictionary and their indexes, for
+// checking that processes exchanging rules encode them with the same words.
+uint64_t GetDictionaryFingerprint(Dictionary& dictionary);
+
+void WriteRuleCountFile(const string& filename, const RuleCounts& counts,
+                        Dictionary& dictionary);
+
+class RuleCountWriter {
+ public:
+  RuleCountWriter(const string& filename, Dictionary& dictionary);
+
+  // Entries must be written in increasing order.
+  void Write(const RuleCountEntry& entry);
+
+ private:
+  ofstream out;
+};
+
+class RuleCountReader {
+ public:
+  // Adds the tokens of the file to the dictionary, which must be either empty
+  // or identical to the dictionary of the file.
+  RuleCountReader(const string& filename, Dictionary& dictionary);
+
+  // Returns false if there are no more entries.
+  bool Next(RuleCountEntry& entry);
+
+ private:
+  ifstream in;
+};
@@ -4,7 +4,7 @@ Rule RuleExtractor::ExtractRule(
     const Instance& instance, const NodeIter& node) const {
   AlignedTree fragment = instance.first.GetFragment(node);
   String target_string = ConstructRuleTargetSide(fragment, instance.second);
-  return make_pair(fragment, target_string);
+  return Rule(move(fragment), move(target_string));
 }
 
 String RuleExtractor::ConstructRuleTargetSide(
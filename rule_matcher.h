@@ -1,25 +1,32 @@
 #pragma once
 
-#include <map>
 #include <vector>
 
 #include "grammar.h"
+#include "indexed_tree.h"
 #include "util.h"
 
 using namespace std;
 
-typedef vector<pair<pair<Rule, double>, vector<NodeIter>>> MatchingRules;
-
+// Finds the grammar rules matching every node of a tree. The matches refer to
+// the rules owned by the grammar, which must outlive the matcher.
 class RuleMatcher {
  public:
-  RuleMatcher(const Grammar& grammar, const AlignedTree& tree);
+  RuleMatcher(const Grammar& grammar, const IndexedTree& tree);
 
-  MatchingRules GetRules(const NodeIter& node) const;
+  // The matches of the node, sorted by rule index.
+  const vector<FragmentMatch>& GetRules(int node) const;
 
- private:
-  bool MatchRule(const AlignedTree& tree, const NodeIter& tree_node,
-                 const AlignedTree& frag, const NodeIter& frag_node,
-                 vector<NodeIter>& frontier) const;
+  const pair<Rule, double>& GetRule(int node,
+                                    const FragmentMatch& match) const;
 
-  map<NodeIter, MatchingRules> matcher;
+  // The ids of the tree nodes matched by the frontier nonterminals of the
+  // rule, from left to right.
+  const int* GetFrontier(const FragmentMatch& match) const;
+
+ private:
+  // Indexed by the preorder ids of the tree nodes.
+  vector<vector<FragmentMatch>> matches;
+  vector<const vector<pair<Rule, double>>*> node_rules;
+  vector<int> frontier_pool;
 };
@@ -3,12 +3,12 @@
 #include "dictionary.h"
 #include "aligned_tree.h"
 
-void RuleStatsReporter::UpdateRuleStats(const pair<Rule, double>& rule) {
-  if (IsReorderingRule(rule.first)) {
+void RuleStatsReporter::UpdateRuleStats(const Rule& rule, double prob) {
+  if (IsReorderingRule(rule)) {
     #pragma omp critical
     {
-      ++rule_counts[rule.first];
-      rule_probs[rule.first] = rule.second;
+      ++rule_counts[rule];
+      rule_probs[rule] = prob;
     }
   }
 }
@@ -8,7 +8,7 @@ using namespace std;
 
 class RuleStatsReporter {
  public:
-  void UpdateRuleStats(const pair<Rule, double>& rule);
+  void UpdateRuleStats(const Rule& rule, double prob);
 
   void DisplayRuleStats(ostream& stream, Dictionary& dictionary);
 
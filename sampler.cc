@@ -1,11 +1,17 @@
 #include "sampler.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include <omp.h>
 
+#include "count_exchange.h"
+#include "memory_util.h"
+#include "metrics.h"
 #include "node.h"
+#include "numa_topology.h"
 #include "pcfg_table.h"
+#include "rule_count_file.h"
 #include "time_util.h"
 #include "translation_table.h"
 
@@ -14,8 +20,9 @@ Sampler::Sampler(const shared_ptr<vector<Instance>>& training,
                  const shared_ptr<PCFGTable>& pcfg_table,
                  const shared_ptr<TranslationTable>& forward_table,
                  const shared_ptr<TranslationTable>& reverse_table,
-                 RandomGenerator& generator, int num_threads,
-                 bool enable_all_stats, bool smart_expand,
+                 const shared_ptr<CountExchangeClient>& exchange,
+                 RandomGenerator& generator, int num_threads, bool numa,
+                 bool enable_all_stats, bool memory_stats, bool smart_expand,
                  int min_rule_count, bool reorder, double penalty,
                  int max_leaves, int max_tree_size, double alpha,
                  double pexpand, double pchild, double pterm,
@@ -27,14 +34,20 @@ Sampler::Sampler(const shared_ptr<vector<Instance>>& training,
     pcfg_table(pcfg_table),
     forward_table(forward_table),
     reverse_table(reverse_table),
+    exchange(exchange),
     generator(generator),
     uniform_distribution(0, 1),
     num_threads(num_threads),
+    topology(numa ? make_shared<NumaTopology>(num_threads) : nullptr),
+    sentence_shards(training->size()),
     enable_all_stats(enable_all_stats),
+    grammar_stats(num_threads),
+    memory_stats(memory_stats),
     min_rule_count(min_rule_count),
     reorder(reorder),
     rule_reorderer(penalty, max_leaves, max_tree_size),
     reorder_counts(training->size()),
+    scheduler(training),
     smart_expand(smart_expand),
     alpha(alpha),
     prob_expand(log(pexpand)),
@@ -43,10 +56,13 @@ Sampler::Sampler(const shared_ptr<vector<Instance>>& training,
     prob_cont_child(log(1 - pchild)),
     prob_stop_str(log(pterm)),
     prob_cont_str(log(1 - pterm)),
-    output_directory(output_directory) {
+    output_directory(output_directory),
+    sampling_time(0),
+    synchronization_time(0) {
   set<int> non_terminals, source_terminals, target_terminals;
   // Do not parallelize.
   for (auto instance: *training) {
+    grammar_stats[0].AddNodes(instance.first.size());
     for (auto node: instance.first) {
       if (!non_terminals.count(node.GetTag())) {
         non_terminals.insert(node.GetTag());
@@ -92,9 +108,21 @@ Sampler::Sampler(const shared_ptr<vector<Instance>>& training,
 
 void Sampler::Sample(int iterations, int log_frequency,
                      int start_index, int end_index) {
+  if (topology != nullptr) {
+    PlaceShards(start_index, end_index);
+  }
+
   InitializeRuleCounts();
 
   counts.Synchronize();
+  if (memory_stats) {
+    DisplayMemoryUsage();
+  }
+
+  ofstream metrics_stream;
+  if (Metrics::IsEnabled()) {
+    metrics_stream.open(GetOutputFilename(output_directory, "metrics"));
+  }
 
   for (int iter = 0; iter < iterations; ++iter) {
     auto start_time = GetTime();
@@ -104,7 +132,9 @@ void Sampler::Sample(int iterations, int log_frequency,
     }
 
     if (iter % log_frequency == 0) {
+      ScopedPhase phase(PHASE_SERIALIZE);
       SerializeInternalState(to_string(iter));
+      SerializeRuleCounts(to_string(iter));
       cerr << "Serializing the grammar..." << endl;
       SerializeGrammar(false, to_string(iter));
       if (reorder) {
@@ -113,23 +143,50 @@ void Sampler::Sample(int iterations, int log_frequency,
       cerr << "Done..." << endl;
     }
 
-    vector<int> schedule(end_index - start_index);
-    iota(schedule.begin(), schedule.end(), start_index);
-    random_shuffle(schedule.begin(), schedule.end());
-    #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
-    for (size_t i = 0; i < schedule.size(); ++i) {
-      Instance& instance = (*training)[schedule[i]];
+    vector<int> schedule = scheduler.GetSchedule(start_index, end_index);
+    vector<double> busy_times(num_threads);
+    NumaStats numa_stats;
+    if (topology != nullptr) {
+      numa_stats = topology->GetStats();
+    }
 
-      // Ignore parse failures.
-      if (instance.first.size() <= 1) {
-        continue;
+    auto sweep_start_time = GetTime();
+    if (topology == nullptr) {
+      #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+      for (size_t i = 0; i < schedule.size(); ++i) {
+        SampleSentence(schedule[i], busy_times);
       }
-      CacheSentence(instance);
-      SampleAlignments(instance, schedule[i]);
-      SampleSwaps(instance);
+    } else {
+      SampleShards(schedule, busy_times);
     }
+    auto sweep_end_time = GetTime();
 
-    counts.Synchronize();
+    double sweep_duration = duration_cast<microseconds>(
+        sweep_end_time - sweep_start_time).count() / 1e6;
+    sampling_time += sweep_duration;
+    double idle_time = 0;
+    for (double busy_time: busy_times) {
+      idle_time += max(sweep_duration - busy_time, 0.0);
+    }
+    cerr << "Thread idle time: " << idle_time << " seconds ("
+         << 100 * idle_time / (num_threads * sweep_duration) << "%)" << endl;
+    if (topology != nullptr) {
+      cerr << "Remote page allocations (system-wide): "
+           << 100 * topology->GetStats().GetRemoteAllocationFraction(
+                  numa_stats)
+           << "%" << endl;
+    }
+
+    auto sync_start_time = GetTime();
+    SynchronizeCounts();
+    synchronization_time += duration_cast<microseconds>(
+        GetTime() - sync_start_time).count() / 1e6;
+    if (memory_stats) {
+      DisplayMemoryUsage();
+    }
+    if (Metrics::IsEnabled()) {
+      Metrics::WriteJSON(metrics_stream, iter);
+    }
 
     auto end_time = GetTime();
     cout << "Iteration " << iter << " completed in "
@@ -141,6 +198,114 @@ void Sampler::Sample(int iterations, int log_frequency,
   }
 }
 
+double Sampler::GetSamplingTime() const {
+  return sampling_time;
+}
+
+double Sampler::GetSynchronizationTime() const {
+  return synchronization_time;
+}
+
+void Sampler::PlaceShards(int start_index, int end_index) {
+  cerr << "Placing corpus shards on " << topology->GetNumNodes()
+       << " NUMA nodes..." << endl;
+  // Each node receives a contiguous shard proportional to its threads.
+  int num_nodes = topology->GetNumNodes();
+  vector<int> shard_bounds(num_nodes + 1, start_index);
+  for (int node = 0; node < num_nodes; ++node) {
+    long long node_threads = topology->GetNumThreads(node);
+    shard_bounds[node + 1] = shard_bounds[node] +
+        node_threads * (end_index - start_index) / num_threads;
+  }
+  shard_bounds.back() = end_index;
+
+  for (int node = 0; node < num_nodes; ++node) {
+    for (int i = shard_bounds[node]; i < shard_bounds[node + 1]; ++i) {
+      sentence_shards[i] = node;
+    }
+  }
+
+  #pragma omp parallel num_threads(num_threads)
+  {
+    int thread_id = omp_get_thread_num();
+    topology->PinThread(thread_id);
+
+    // Copy the sentences of the shard from the threads of the node to place
+    // them in local memory (first-touch policy).
+    int node = topology->GetNode(thread_id);
+    int node_threads = topology->GetNumThreads(node);
+    int first_thread = thread_id;
+    while (first_thread > 0 && topology->GetNode(first_thread - 1) == node) {
+      --first_thread;
+    }
+    for (int i = shard_bounds[node] + thread_id - first_thread;
+         i < shard_bounds[node + 1]; i += node_threads) {
+      Instance local_copy((*training)[i]);
+      (*training)[i].first = move(local_copy.first);
+      (*training)[i].second.swap(local_copy.second);
+    }
+  }
+  cerr << "Done..." << endl;
+}
+
+void Sampler::SampleShards(
+    const vector<int>& schedule, vector<double>& busy_times) {
+  int num_nodes = topology->GetNumNodes();
+  vector<vector<int>> shard_schedules(num_nodes);
+  for (int index: schedule) {
+    shard_schedules[sentence_shards[index]].push_back(index);
+  }
+
+  vector<size_t> next_sentence(num_nodes);
+  #pragma omp parallel num_threads(num_threads)
+  {
+    int thread_id = omp_get_thread_num();
+    topology->PinThread(thread_id);
+
+    // Sample the local shard first, then help the other nodes.
+    int node = topology->GetNode(thread_id);
+    for (int i = 0; i < num_nodes; ++i) {
+      int shard = (node + i) % num_nodes;
+      while (true) {
+        size_t position;
+        #pragma omp atomic capture
+        position = next_sentence[shard]++;
+
+        if (position >= shard_schedules[shard].size()) {
+          break;
+        }
+        SampleSentence(shard_schedules[shard][position], busy_times);
+      }
+    }
+  }
+}
+
+void Sampler::SampleSentence(int index, vector<double>& busy_times) {
+  Instance& instance = (*training)[index];
+
+  // Ignore parse failures.
+  if (instance.first.size() <= 1) {
+    return;
+  }
+
+  auto start_time = GetTime();
+  CacheSentence(instance);
+  {
+    ScopedPhase phase(PHASE_SAMPLE_ALIGNMENTS);
+    SampleAlignments(instance, index);
+  }
+  {
+    ScopedPhase phase(PHASE_SAMPLE_SWAPS);
+    SampleSwaps(instance);
+  }
+  auto end_time = GetTime();
+
+  double duration = duration_cast<microseconds>(
+      end_time - start_time).count() / 1e6;
+  scheduler.UpdateCost(index, duration);
+  busy_times[omp_get_thread_num()] += duration;
+}
+
 void Sampler::InitializeRuleCounts() {
   #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
   for (size_t i = 0; i < training->size(); ++i) {
@@ -154,6 +319,15 @@ void Sampler::InitializeRuleCounts() {
   }
 }
 
+void Sampler::SynchronizeCounts() {
+  ScopedPhase phase(PHASE_SYNCHRONIZE);
+  if (exchange == nullptr) {
+    counts.Synchronize();
+  } else {
+    counts.Synchronize(*exchange);
+  }
+}
+
 void Sampler::CacheSentence(const Instance& instance) {
   if (forward_table == nullptr || reverse_table == nullptr) {
     return;
@@ -179,12 +353,13 @@ void Sampler::DisplayStats() {
   auto start_time = GetTime();
   cout << "Log-likelihood: " << fixed << ComputeDataLikelihood() << endl;
   if (enable_all_stats) {
+    GrammarStats stats = GetGrammarStats();
     cout << "\tAverage number of interior nodes: "
-         << ComputeAverageNumInteriorNodes() << endl;
+         << ComputeAverageNumInteriorNodes(stats) << endl;
     cout << "\tGrammar size: " << GetGrammarSize() << endl;
 
     cout << "\tRule histogram: ";
-    auto histogram = GenerateRuleHistogram();
+    auto histogram = stats.GetHistogram();
     for (auto entry: histogram) {
       cout << "(" << entry.first << ", " << entry.second << ") ";
     }
@@ -195,136 +370,144 @@ void Sampler::DisplayStats() {
        << " seconds..." << endl;
 }
 
-double Sampler::ComputeDataLikelihood() {
-  DistributedRuleCounts new_counts(num_threads, alpha);
-  for (auto nonterminal: counts.GetNonterminals()) {
-    new_counts.AddNonterminal(nonterminal);
-  }
+void Sampler::DisplayMemoryUsage() {
+  MemoryReport report;
 
-  vector<double> likelihoods(num_threads);
-  #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
-  for (size_t i = 0; i < training->size(); ++i) {
-    int thread_id = omp_get_thread_num();
-    const Instance& instance = (*training)[i];
-    CacheSentence(instance);
-    const AlignedTree& tree = instance.first;
-    for (auto node = tree.begin(); node != tree.end(); ++node) {
-      if (node->IsSplitNode()) {
-        const Rule& rule = extractor.ExtractRule(instance, node);
-        double prob = ComputeLogBaseProbability(rule);
-        likelihoods[thread_id] += new_counts.GetLogProbability(rule, prob);
-        new_counts.Increment(rule);
-      }
-    }
+  long long corpus_memory = training->capacity() * sizeof(Instance);
+  for (const Instance& instance: *training) {
+    corpus_memory += GetMemoryUsage(instance);
   }
+  report.Add("Corpus", corpus_memory);
 
-  double likelihood = 0;
-  for (int i = 0; i < num_threads; ++i) {
-    likelihood += likelihoods[i];
+  report.Add("Rule counts (per thread replicas)",
+             counts.GetReplicaMemoryUsage());
+
+  map<int, long long> snapshot_memory = counts.GetSnapshotMemoryUsage();
+  long long total_snapshot_memory = 0;
+  vector<pair<long long, int>> tag_memory;
+  for (const auto& entry: snapshot_memory) {
+    total_snapshot_memory += entry.second;
+    tag_memory.push_back(make_pair(entry.second, entry.first));
   }
+  report.Add("Rule counts (snapshot)", total_snapshot_memory);
 
-  return likelihood;
-}
+  // Only display the root tags with the largest restaurants.
+  const size_t max_tags = 10;
+  sort(tag_memory.rbegin(), tag_memory.rend());
+  for (size_t i = 0; i < min(max_tags, tag_memory.size()); ++i) {
+    report.AddDetail("Snapshot " + dictionary.GetToken(tag_memory[i].second),
+                     tag_memory[i].first);
+  }
 
-double Sampler::ComputeAverageNumInteriorNodes() {
-  vector<int> interior_nodes(num_threads), total_rules(num_threads);
-  #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
-  for (size_t i = 0; i < training->size(); ++i) {
-    int thread_id = omp_get_thread_num();
-    const AlignedTree& tree = (*training)[i].first;
-    for (auto node = tree.begin(); node != tree.end(); ++node) {
-      if (!node->IsSplitNode()) {
-        ++interior_nodes[thread_id];
-      } else {
-        ++total_rules[thread_id];
-      }
+  long long reorder_memory =
+      reorder_counts.capacity() * sizeof(map<String, int>);
+  for (const auto& sentence_counts: reorder_counts) {
+    reorder_memory += GetMemoryUsage(sentence_counts);
+    for (const auto& entry: sentence_counts) {
+      reorder_memory += GetMemoryUsage(entry.first);
     }
   }
+  report.Add("Reordering counts", reorder_memory);
 
-  int interior_nodes_sum = 0, total_rules_sum = 0;
-  for (int i = 0; i < num_threads; ++i) {
-    interior_nodes_sum += interior_nodes[i];
-    total_rules_sum += total_rules[i];
+  if (forward_table != nullptr && reverse_table != nullptr) {
+    report.Add("Translation tables", forward_table->GetTableMemoryUsage() +
+                                     reverse_table->GetTableMemoryUsage());
+    report.Add("Sentence caches", forward_table->GetCacheMemoryUsage() +
+                                  reverse_table->GetCacheMemoryUsage());
   }
 
-  cerr << "\tTotal rules: " << total_rules_sum << endl;
-  return (double) interior_nodes_sum / total_rules_sum;
+  report.Write(cerr);
 }
 
-int Sampler::GetGrammarSize() {
-  vector<set<Rule>> grammars(num_threads);
-  #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
-  for (size_t i = 0; i < training->size(); ++i) {
-    int thread_id = omp_get_thread_num();
-    const Instance& instance = (*training)[i];
-    const AlignedTree& tree = instance.first;
-    for (auto node = tree.begin(); node != tree.end(); ++node) {
-      if (node->IsSplitNode()) {
-        grammars[thread_id].insert(extractor.ExtractRule(instance, node));
-      }
+double Sampler::ComputeDataLikelihood() {
+  // The joint probability of a seating arrangement in a Chinese restaurant
+  // process does not depend on the order in which the customers arrived, so we
+  // compute it in closed form from the synchronized rule counts.
+  double likelihood = 0;
+  vector<pair<const Rule*, int>> rules;
+  for (const auto& entry: counts.GetSnapshot()) {
+    const auto& restaurant = entry.second;
+    likelihood -= lgamma(restaurant.GetTotal() + alpha) - lgamma(alpha);
+    for (const auto& rule_entry: restaurant.Get()) {
+      rules.push_back(make_pair(&rule_entry.first, rule_entry.second));
     }
   }
 
-  set<Rule> grammar;
-  for (int i = 0; i < num_threads; ++i) {
-    grammar.insert(grammars[i].begin(), grammars[i].end());
+  vector<double> likelihoods(rules.size());
+  #pragma omp parallel for schedule(dynamic, 1000) num_threads(num_threads)
+  for (size_t i = 0; i < rules.size(); ++i) {
+    // Log of the rising factorial x (x + 1) ... (x + n - 1), where
+    // x = alpha * p0. The first factor is kept separate because x may
+    // underflow for large rules.
+    double log_p0 = ComputeLogBaseProbability(*rules[i].first, false);
+    double x = alpha * exp(log_p0);
+    likelihoods[i] = log(alpha) + log_p0 +
+                     lgamma(x + rules[i].second) - lgamma(x + 1);
+  }
+
+  // Sum up sequentially so that the result does not depend on the schedule.
+  for (double rule_likelihood: likelihoods) {
+    likelihood += rule_likelihood;
   }
-  return grammar.size();
+
+  return likelihood;
 }
 
-map<int, int> Sampler::GenerateRuleHistogram() {
-  vector<map<int, int>> histograms(num_threads);
-  #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
-  for (size_t i = 0; i < training->size(); ++i) {
-    int thread_id = omp_get_thread_num();
-    const AlignedTree& tree = (*training)[i].first;
+GrammarStats Sampler::GetGrammarStats() {
+  GrammarStats stats;
+  for (const auto& thread_stats: grammar_stats) {
+    stats.Add(thread_stats);
+  }
+  return stats;
+}
+
+GrammarStats Sampler::RecountGrammarStats() {
+  GrammarStats stats;
+  for (const Instance& instance: *training) {
+    const AlignedTree& tree = instance.first;
+    stats.AddNodes(tree.size());
     for (auto node = tree.begin(); node != tree.end(); ++node) {
       if (node->IsSplitNode()) {
-        const AlignedTree& frag = tree.GetFragment(node);
-        int inner_nodes = frag.size() - 1;
-
-        if (frag.size() > 1) {
-          for (auto leaf = frag.begin_leaf(); leaf != frag.end_leaf(); ++leaf) {
-            if (leaf->IsSplitNode()) {
-              --inner_nodes;
-            }
-          }
-        }
-
-        ++histograms[thread_id][inner_nodes];
+        stats.Update(extractor.ExtractRule(instance, node), 1);
       }
     }
   }
+  return stats;
+}
 
-  map<int, int> histogram;
-  for (int i = 0; i < num_threads; ++i) {
-    for (const auto& entry: histograms[i]) {
-      histogram[entry.first] += entry.second;
-    }
-  }
+double Sampler::ComputeAverageNumInteriorNodes(const GrammarStats& stats) {
+  cerr << "\tTotal rules: " << stats.GetNumRules() << endl;
+  return (double) stats.GetNumInteriorNodes() / stats.GetNumRules();
+}
 
-  return histogram;
+int Sampler::GetGrammarSize() {
+  int grammar_size = 0;
+  for (const auto& entry: counts.GetSnapshot()) {
+    grammar_size += entry.second.Get().size();
+  }
+  return grammar_size;
 }
 
 void Sampler::SampleAlignments(const Instance& instance, int index) {
   const AlignedTree& tree = instance.first;
   vector<NodeIter> schedule = GetRandomSchedule(tree);
+  Metrics::Increment(COUNTER_NODES_SAMPLED, schedule.size());
 
   // For each node, sample a new alignment span.
   for (auto node: schedule) {
     auto ancestor = tree.GetSplitAncestor(node);
 
     // Decrement existing rule counts.
-    DecrementRuleCount(extractor.ExtractRule(instance, ancestor));
+    DecrementRuleCount(ExtractRule(instance, ancestor));
     if (node->IsSplitNode()) {
-      DecrementRuleCount(extractor.ExtractRule(instance, node));
+      DecrementRuleCount(ExtractRule(instance, node));
     }
 
     vector<double> probs;
     // Compute probability for not splitting the node (single rule).
     node->SetSplitNode(false);
     node->SetSpan(make_pair(-1, -1));
-    const Rule& monolithic_rule = extractor.ExtractRule(instance, ancestor);
+    const Rule& monolithic_rule = ExtractRule(instance, ancestor);
     probs.push_back(ComputeLogProbability(monolithic_rule));
 
     // Find possible alignment spans and compute the probability for each one.
@@ -332,8 +515,8 @@ void Sampler::SampleAlignments(const Instance& instance, int index) {
     auto legal_spans = GetLegalSpans(tree, node, ancestor);
     for (auto span: legal_spans) {
       node->SetSpan(span);
-      const Rule& ancestor_rule = extractor.ExtractRule(instance, ancestor);
-      const Rule& node_rule = extractor.ExtractRule(instance, node);
+      const Rule& ancestor_rule = ExtractRule(instance, ancestor);
+      const Rule& node_rule = ExtractRule(instance, node);
       probs.push_back(ComputeLogProbability(ancestor_rule, node_rule));
     }
 
@@ -354,7 +537,7 @@ void Sampler::SampleAlignments(const Instance& instance, int index) {
     if (value <= probs[0]) {
       node->SetSplitNode(false);
       node->SetSpan(make_pair(-1, -1));
-      IncrementRuleCount(extractor.ExtractRule(instance, ancestor));
+      IncrementRuleCount(ExtractRule(instance, ancestor));
       continue;
     } else {
       node->SetSplitNode(true);
@@ -365,8 +548,8 @@ void Sampler::SampleAlignments(const Instance& instance, int index) {
     for (size_t i = 1; i < probs.size(); ++i) {
       if (value <= probs[i]) {
         node->SetSpan(legal_spans[i - 1]);
-        IncrementRuleCount(extractor.ExtractRule(instance, ancestor));
-        IncrementRuleCount(extractor.ExtractRule(instance, node));
+        IncrementRuleCount(ExtractRule(instance, ancestor));
+        IncrementRuleCount(ExtractRule(instance, node));
         sampled = true;
         break;
       }
@@ -405,9 +588,10 @@ void Sampler::SampleSwaps(const Instance& instance) {
     random_shuffle(descendants.begin(), descendants.end());
     // Sample swaps for consecutive pairs of descendants.
     for (size_t i = 1; i < descendants.size(); i += 2) {
-      const Rule& rule1 = extractor.ExtractRule(instance, node);
-      const Rule& rule2 = extractor.ExtractRule(instance, descendants[i - 1]);
-      const Rule& rule3 = extractor.ExtractRule(instance, descendants[i]);
+      Metrics::Increment(COUNTER_SWAPS_SAMPLED);
+      const Rule& rule1 = ExtractRule(instance, node);
+      const Rule& rule2 = ExtractRule(instance, descendants[i - 1]);
+      const Rule& rule3 = ExtractRule(instance, descendants[i]);
       DecrementRuleCount(rule1);
       DecrementRuleCount(rule2);
       DecrementRuleCount(rule3);
@@ -420,9 +604,9 @@ void Sampler::SampleSwaps(const Instance& instance) {
       descendants[i - 1]->SetSpan(span2);
       descendants[i]->SetSpan(span1);
 
-      const Rule& srule1 = extractor.ExtractRule(instance, node);
-      const Rule& srule2 = extractor.ExtractRule(instance, descendants[i - 1]);
-      const Rule& srule3 = extractor.ExtractRule(instance, descendants[i]);
+      const Rule& srule1 = ExtractRule(instance, node);
+      const Rule& srule2 = ExtractRule(instance, descendants[i - 1]);
+      const Rule& srule3 = ExtractRule(instance, descendants[i]);
 
       double prob_swap = ComputeLogProbability(srule1, srule2, srule3);
 
@@ -465,53 +649,18 @@ vector<NodeIter> Sampler::GetRandomSchedule(const AlignedTree& tree) {
 vector<pair<int, int>> Sampler::GetLegalSpans(const AlignedTree& tree,
                                               const NodeIter& node,
                                               const NodeIter& ancestor) {
-  pair<int, int> root_span = ancestor->GetSpan();
-  vector<bool> include(root_span.second, false);
-  vector<bool> exclude(root_span.second, false);
-
-  // Exclude indexes contained by sibling nodes.
-  vector<NodeIter> siblings = tree.GetSplitDescendants(ancestor);
-  for (auto sibling: siblings) {
-    if (sibling != node) {
-      pair<int, int> span = sibling->GetSpan();
-      for (int j = span.first; j < span.second; ++j) {
-        exclude[j] = true;
-      }
-    }
-  }
-
-  // Include indexes contained by descendant nodes.
-  int total_includes = 0;
-  vector<NodeIter> descendants = tree.GetSplitDescendants(node);
-  for (auto descendant: descendants) {
-    pair<int, int> span = descendant->GetSpan();
-    for (int j = span.first; j < span.second; ++j) {
-      include[j] = true;
-      ++total_includes;
-    }
-  }
-
-  // Loop over all possible span candidates. A legal span is a span that
-  // contains all includes and no excludes.
-  vector<pair<int, int>> legal_spans;
-  for (int start = root_span.first; start < root_span.second; ++start) {
-    int includes = 0;
-    for (int end = start + 1; end <= root_span.second; ++end) {
-      if (exclude[end - 1]) {
-        break;
-      }
-
-      includes += include[end - 1];
-      if (includes == total_includes) {
-        legal_spans.push_back(make_pair(start, end));
-      }
-    }
-  }
-
+  ScopedPhase phase(PHASE_LEGAL_SPANS);
+  auto legal_spans = tree.GetLegalSpans(node, ancestor);
+  Metrics::Increment(COUNTER_LEGAL_SPANS, legal_spans.size());
   return legal_spans;
 }
 
 double Sampler::ComputeLogBaseProbability(const Rule& rule) {
+  return ComputeLogBaseProbability(rule, true);
+}
+
+double Sampler::ComputeLogBaseProbability(const Rule& rule, bool use_cache) {
+  ScopedPhase phase(PHASE_BASE_PROBABILITY);
   int vars = 0;
   double prob_frag = 0;
   const AlignedTree& frag = rule.first;
@@ -565,25 +714,36 @@ double Sampler::ComputeLogBaseProbability(const Rule& rule) {
     prob_str = prob_stop_str;
     prob_str += (prob_tt + prob_cont_str) * (target_string.size() - vars);
   } else {
-    vector<int> source_indexes;
+    // Word indexes into the cached sentence or the words themselves.
+    vector<int> source_items;
     for (auto leaf = frag.begin_leaf(); leaf != frag.end_leaf(); ++leaf) {
       if (leaf->IsSetWord() && (!leaf->IsSplitNode() || leaf == frag.begin())) {
-        source_indexes.push_back(leaf->GetWordIndex());
+        source_items.push_back(
+            use_cache ? leaf->GetWordIndex() : leaf->GetWord());
       }
     }
 
-    vector<int> target_indexes;
+    vector<int> target_items;
     for (auto node: target_string) {
       if (node.IsSetWord()) {
-        target_indexes.push_back(node.GetWordIndex());
+        target_items.push_back(
+            use_cache ? node.GetWordIndex() : node.GetWord());
       }
     }
 
     // Use geometric mean on bidirectional IBM Model 1 probabilities.
-    double prob_forward = forward_table->ComputeAverageLogProbability(
-        source_indexes, target_indexes, omp_get_thread_num());
-    double prob_reverse = reverse_table->ComputeAverageLogProbability(
-        target_indexes, source_indexes, omp_get_thread_num());
+    double prob_forward, prob_reverse;
+    if (use_cache) {
+      prob_forward = forward_table->ComputeAverageLogProbability(
+          source_items, target_items, omp_get_thread_num());
+      prob_reverse = reverse_table->ComputeAverageLogProbability(
+          target_items, source_items, omp_get_thread_num());
+    } else {
+      prob_forward = forward_table->ComputeAverageLogProbability(
+          source_items, target_items);
+      prob_reverse = reverse_table->ComputeAverageLogProbability(
+          target_items, source_items);
+    }
     prob_str = 0.5 * (prob_forward + prob_reverse);
   }
 
@@ -595,7 +755,10 @@ double Sampler::ComputeLogBaseProbability(const Rule& rule) {
 }
 
 double Sampler::ComputeLogProbability(const Rule& rule) {
-  return counts.GetLogProbability(rule, ComputeLogBaseProbability(rule));
+  double log_p0 = ComputeLogBaseProbability(rule);
+  RecordRestaurantLookup(rule);
+  ScopedPhase phase(PHASE_RESTAURANT_LOOKUP);
+  return counts.GetLogProbability(rule, log_p0);
 }
 
 double Sampler::ComputeLogProbability(const Rule& r1, const Rule& r2) {
@@ -603,8 +766,10 @@ double Sampler::ComputeLogProbability(const Rule& r1, const Rule& r2) {
 
   int same_rules = r1 == r2;
   int same_tags = r1.first.GetRootTag() == r2.first.GetRootTag();
-  return prob_r1 + counts.GetLogProbability(
-      r2, same_rules, same_tags, ComputeLogBaseProbability(r2));
+  double log_p0 = ComputeLogBaseProbability(r2);
+  RecordRestaurantLookup(r2);
+  ScopedPhase phase(PHASE_RESTAURANT_LOOKUP);
+  return prob_r1 + counts.GetLogProbability(r2, same_rules, same_tags, log_p0);
 }
 
 double Sampler::ComputeLogProbability(const Rule& r1, const Rule& r2,
@@ -614,16 +779,39 @@ double Sampler::ComputeLogProbability(const Rule& r1, const Rule& r2,
   int same_rules = (r1 == r3) + (r2 == r3);
   int same_tags = (r1.first.GetRootTag() == r3.first.GetRootTag()) +
                   (r2.first.GetRootTag() == r3.first.GetRootTag());
-  return prob_r12 + counts.GetLogProbability(
-      r3, same_rules, same_tags, ComputeLogBaseProbability(r3));
+  double log_p0 = ComputeLogBaseProbability(r3);
+  RecordRestaurantLookup(r3);
+  ScopedPhase phase(PHASE_RESTAURANT_LOOKUP);
+  return prob_r12 + counts.GetLogProbability(r3, same_rules, same_tags, log_p0);
+}
+
+void Sampler::RecordRestaurantLookup(const Rule& rule) {
+  if (Metrics::IsEnabled()) {
+    Metrics::Increment(COUNTER_RESTAURANT_LOOKUPS);
+    if (counts.Count(rule) > 0) {
+      Metrics::Increment(COUNTER_RESTAURANT_HITS);
+    }
+  }
+}
+
+Rule Sampler::ExtractRule(const Instance& instance, const NodeIter& node) {
+  ScopedPhase phase(PHASE_EXTRACT_RULE);
+  Metrics::Increment(COUNTER_RULES_EXTRACTED);
+  return extractor.ExtractRule(instance, node);
 }
 
 void Sampler::IncrementRuleCount(const Rule& rule) {
   counts.Increment(rule);
+  if (enable_all_stats) {
+    grammar_stats[omp_get_thread_num()].Update(rule, 1);
+  }
 }
 
 void Sampler::DecrementRuleCount(const Rule& rule) {
   counts.Decrement(rule);
+  if (enable_all_stats) {
+    grammar_stats[omp_get_thread_num()].Update(rule, -1);
+  }
 }
 
 void Sampler::InferReorderings() {
@@ -803,3 +991,16 @@ void Sampler::SerializeInternalState(const string& iteration) {
   cerr << "Internal state serialized in " << GetDuration(start_time, end_time)
        << " seconds..." << endl;
 }
+
+void Sampler::SerializeRuleCounts(const string& iteration) {
+  cerr << "Serializing rule counts..." << endl;
+  auto start_time = GetTime();
+
+  WriteRuleCountFile(
+      GetOutputFilename(output_directory, iteration, "counts"),
+      counts.GetSnapshot(), dictionary);
+
+  auto end_time = GetTime();
+  cerr << "Rule counts serialized in " << GetDuration(start_time, end_time)
+       << " seconds..." << endl;
+}
@@ -9,12 +9,16 @@
 #include "alignment_constructor.h"
 #include "dictionary.h"
 #include "distributed_rule_counts.h"
+#include "grammar_stats.h"
 #include "rule_extractor.h"
 #include "rule_reorderer.h"
+#include "sentence_scheduler.h"
 #include "util.h"
 
 using namespace std;
 
+class CountExchangeClient;
+class NumaTopology;
 class PCFGTable;
 class TranslationTable;
 
@@ -26,7 +30,9 @@ class Sampler {
           const shared_ptr<PCFGTable>& pcfg_table,
           const shared_ptr<TranslationTable>& forward_table,
           const shared_ptr<TranslationTable>& reverse_table,
-          RandomGenerator& generator, int num_threads, bool enable_all_stats,
+          const shared_ptr<CountExchangeClient>& exchange,
+          RandomGenerator& generator, int num_threads, bool numa,
+          bool enable_all_stats, bool memory_stats,
           bool smart_expand, int min_rule_count, bool reorder, double penalty,
           int max_leaves, int max_tree_size, double alpha,
           double pexpand, double pchild, double pterm,
@@ -43,21 +49,50 @@ class Sampler {
 
   void SerializeInternalState(const string& iteration = "");
 
+  void SerializeRuleCounts(const string& iteration = "");
+
+  // Wall clock time (in seconds) spent sampling the sentences and merging the
+  // rule counts during the sampling iterations.
+  double GetSamplingTime() const;
+
+  double GetSynchronizationTime() const;
+
+  // The statistics displayed with --stats, maintained incrementally.
+  GrammarStats GetGrammarStats();
+
+  // Computes the same statistics with a pass over the corpus.
+  GrammarStats RecountGrammarStats();
+
  private:
+  // Splits the sentences between the NUMA nodes and moves each shard to the
+  // memory of its node.
+  void PlaceShards(int start_index, int end_index);
+
+  // Samples the sentences with threads pinned to NUMA nodes, each thread
+  // preferring the sentences from the shard of its own node.
+  void SampleShards(const vector<int>& schedule, vector<double>& busy_times);
+
+  void SampleSentence(int index, vector<double>& busy_times);
+
   void InitializeRuleCounts();
 
+  // Merges the counts from all threads and, if running as a worker, with the
+  // counts from the other processes.
+  void SynchronizeCounts();
+
   void CacheSentence(const Instance& instance);
 
   void DisplayStats();
 
+  // Displays the approximate memory used by the major data structures.
+  void DisplayMemoryUsage();
+
   double ComputeDataLikelihood();
 
-  double ComputeAverageNumInteriorNodes();
+  double ComputeAverageNumInteriorNodes(const GrammarStats& stats);
 
   int GetGrammarSize();
 
-  map<int, int> GenerateRuleHistogram();
-
   void SampleAlignments(const Instance& instance, int index);
 
   void SampleSwaps(const Instance& instance);
@@ -70,12 +105,22 @@ class Sampler {
 
   double ComputeLogBaseProbability(const Rule& rule);
 
+  // If use_cache is false, the translation probabilities are looked up
+  // directly instead of relying on the cache of the current sentence.
+  double ComputeLogBaseProbability(const Rule& rule, bool use_cache);
+
   double ComputeLogProbability(const Rule& r);
 
   double ComputeLogProbability(const Rule& r1, const Rule& r2);
 
   double ComputeLogProbability(const Rule& r1, const Rule& r2, const Rule& r3);
 
+  // Counts the restaurant lookups and the lookups of rules already seated at a
+  // table. Only does work if the metrics are enabled.
+  void RecordRestaurantLookup(const Rule& rule);
+
+  Rule ExtractRule(const Instance& instance, const NodeIter& node);
+
   void IncrementRuleCount(const Rule& rule);
 
   void DecrementRuleCount(const Rule& rule);
@@ -95,11 +140,19 @@ class Sampler {
   shared_ptr<PCFGTable> pcfg_table;
   shared_ptr<TranslationTable> forward_table;
   shared_ptr<TranslationTable> reverse_table;
+  // Only set if the sampler is a worker exchanging counts with other processes.
+  shared_ptr<CountExchangeClient> exchange;
   RandomGenerator& generator;
   uniform_real_distribution<double> uniform_distribution;
 
   int num_threads;
+  // Only set if sampling in NUMA aware mode.
+  shared_ptr<NumaTopology> topology;
+  vector<int> sentence_shards;
   bool enable_all_stats;
+  // Per thread statistics, updated whenever the rule counts change.
+  vector<GrammarStats> grammar_stats;
+  bool memory_stats;
   // Parameters for filtering the final rules.
   int min_rule_count;
 
@@ -107,6 +160,8 @@ class Sampler {
   RuleReorderer rule_reorderer;
   vector<map<String, int>> reorder_counts;
 
+  SentenceScheduler scheduler;
+
   bool smart_expand;
   unordered_map<int, double> expand_probs;
   unordered_map<int, double> not_expand_probs;
@@ -117,6 +172,9 @@ class Sampler {
   double prob_nt, prob_st, prob_tt;
 
   string output_directory;
+
+  double sampling_time;
+  double synchronization_time;
 };
 
 #endif
@@ -8,7 +8,9 @@
 #include <boost/program_options.hpp>
 
 #include "aligned_tree.h"
+#include "count_exchange.h"
 #include "dictionary.h"
+#include "metrics.h"
 #include "pcfg_table.h"
 #include "sampler.h"
 #include "time_util.h"
@@ -38,10 +40,16 @@ int main(int argc, char **argv) {
       ("output,o", po::value<string>()->required(), "Output prefix")
       ("threads", po::value<int>()->default_value(1)->required(),
           "Number of threads to use for sampling")
+      ("numa", "Pin threads to NUMA nodes and place the corpus shards sampled "
+          "by each node in its local memory")
       ("align", "Infer alignments instead of a STSG grammar")
       ("reorder", "Infer reordering directly from sampled variables")
       ("smart_expand", "Use smart expansion probabilities")
       ("stats", "Display statistics about the grammar after each iteration")
+      ("memory_stats", "Display the memory used by the major data structures "
+          "after each iteration")
+      ("metrics", "Write per iteration timings and counters for the sampling "
+          "hot paths to the output directory (one JSON object per line)")
       ("scfg", "Print grammar as SCFG instead of STSG")
       ("penalty", po::value<double>()->default_value(0.1)->required(),
           "Displacement penalty for reordering")
@@ -70,6 +78,9 @@ int main(int argc, char **argv) {
       ("start_index", po::value<int>(),
           "Start index for sampling interval (0 indexed)")
       ("end_index", po::value<int>(), "End index for sampling interval")
+      ("coordinator", po::value<string>(),
+          "Address of the coordinator (unix:<path> or <host>:<port>) for "
+          "exchanging rule counts with the samplers of the other intervals")
       ("forward-prob", po::value<string>()->required(),
           "Path to the IBM Model 1 translation table p(t|s). Expected format: "
           "source_word_id target_word_id probability.")
@@ -98,52 +109,16 @@ int main(int argc, char **argv) {
 
   int num_threads = vm["threads"].as<int>();
   cerr << "Sampling with " << num_threads << " threads..." << endl;
+  if (vm.count("metrics")) {
+    Metrics::Enable(num_threads);
+  }
 
   Dictionary dictionary;
   shared_ptr<TranslationTable> forward_table, reverse_table;
   LoadTranslationTables(vm, forward_table, reverse_table, dictionary);
 
-  shared_ptr<vector<Instance>> training;
-  if (vm.count("internal")) {
-    training = make_shared<vector<Instance>>(LoadInternalState(vm, dictionary));
-  } else {
-    cerr << "Reading parse trees..." << endl;
-    vector<AlignedTree> parse_trees;
-    ifstream tree_stream(vm["trees"].as<string>());
-    while (!tree_stream.eof()) {
-      parse_trees.push_back(ReadParseTree(tree_stream, dictionary));
-      tree_stream >> ws;
-    }
-    cerr << "Done..." << endl;
-
-    cerr << "Reading target strings..." << endl;
-    vector<String> target_strings;
-    ifstream string_stream(vm["strings"].as<string>());
-    while (!string_stream.eof()) {
-      target_strings.push_back(ReadTargetString(string_stream, dictionary));
-      string_stream >> ws;
-    }
-    cerr << "Done..." << endl;
-
-    cerr << "Reading alignments..." << endl;
-    vector<Alignment> alignments;
-    ifstream alignment_stream(vm["alignment"].as<string>());
-    while (!alignment_stream.eof()) {
-      Alignment alignment;
-      alignment_stream >> alignment >> ws;
-      alignments.push_back(alignment);
-    }
-    cerr << "Done..." << endl;
-
-    assert(parse_trees.size() == target_strings.size() &&
-           parse_trees.size() == alignments.size());
-
-    training = make_shared<vector<Instance>>(parse_trees.size());
-    for (size_t i = 0; i < training->size(); ++i) {
-      (*training)[i] = ConstructInstance(
-          parse_trees[i], target_strings[i], alignments[i]);
-    }
-  }
+  auto training = make_shared<vector<Instance>>(
+      LoadTrainingData(vm, dictionary));
 
   shared_ptr<PCFGTable> pcfg_table;
   if (vm["pcfg"].as<bool>()) {
@@ -169,8 +144,17 @@ int main(int argc, char **argv) {
   if (output_directory.back() != '/') {
     output_directory = output_directory + "/";
   }
+  shared_ptr<CountExchangeClient> exchange;
+  if (vm.count("coordinator")) {
+    exchange = make_shared<CountExchangeClient>(
+        vm["coordinator"].as<string>(), vm["alpha"].as<double>(),
+        dictionary);
+  }
+
   Sampler sampler(training, dictionary, pcfg_table, forward_table,
-                  reverse_table, generator, num_threads, vm.count("stats"),
+                  reverse_table, exchange, generator, num_threads,
+                  vm.count("numa"), vm.count("stats"),
+                  vm.count("memory_stats"),
                   vm.count("smart_expand"), vm["min_rule_count"].as<int>(),
                   vm.count("reorder"), vm["penalty"].as<double>(),
                   vm["max_leaves"].as<int>(), vm["max_tree_size"].as<int>(),
@@ -187,6 +171,7 @@ int main(int argc, char **argv) {
   cerr << "Writing output files..." << endl;
   sampler.SerializeGrammar(vm.count("scfg"));
   sampler.SerializeInternalState();
+  sampler.SerializeRuleCounts();
   if (vm.count("align")) {
     sampler.SerializeAlignments();
   }
@@ -0,0 +1,253 @@
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "dictionary.h"
+#include "memory_util.h"
+#include "pcfg_table.h"
+#include "sampler.h"
+#include "translation_table.h"
+#include "util.h"
+
+using namespace std;
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+struct ScalingResult {
+  double sampling_time;
+  double synchronization_time;
+  long long peak_rss;
+};
+
+// Samples the corpus in a child process, such that the peak memory usage of
+// each run can be measured independently. The parent must not have started
+// any OpenMP threads before forking.
+bool RunSampler(const po::variables_map& vm,
+                const shared_ptr<vector<Instance>>& training,
+                Dictionary& dictionary,
+                const shared_ptr<PCFGTable>& pcfg_table,
+                const shared_ptr<TranslationTable>& forward_table,
+                const shared_ptr<TranslationTable>& reverse_table,
+                int num_threads, ScalingResult& result) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return false;
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    // Keep the output of the sampler away from the results.
+    cout.rdbuf(cerr.rdbuf());
+
+    fs::path output_path =
+        fs::temp_directory_path() / fs::unique_path("worm-scaling-%%%%-%%%%");
+    fs::create_directories(output_path);
+    RandomGenerator generator(vm["seed"].as<unsigned int>());
+    int iterations = vm["iterations"].as<int>();
+    Sampler sampler(training, dictionary, pcfg_table, forward_table,
+                    reverse_table, nullptr, generator, num_threads, false,
+                    false, false, false, 0, false, 0.1, 5, 8,
+                    vm["alpha"].as<double>(), vm["pexpand"].as<double>(),
+                    vm["pchild"].as<double>(), vm["pterm"].as<double>(),
+                    output_path.string() + "/");
+    sampler.Sample(iterations, iterations, 0, training->size());
+    fs::remove_all(output_path);
+
+    FILE* out = fdopen(fds[1], "w");
+    fprintf(out, "%lf %lf %lld\n", sampler.GetSamplingTime(),
+            sampler.GetSynchronizationTime(), GetPeakRSS());
+    fclose(out);
+    _exit(0);
+  }
+
+  close(fds[1]);
+  if (pid < 0) {
+    close(fds[0]);
+    return false;
+  }
+
+  FILE* in = fdopen(fds[0], "r");
+  int num_values = fscanf(in, "%lf %lf %lld", &result.sampling_time,
+                          &result.synchronization_time, &result.peak_rss);
+  fclose(in);
+
+  int status;
+  waitpid(pid, &status, 0);
+  return num_values == 3 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char** argv) {
+  po::options_description cmdline_specific("Command line options");
+  cmdline_specific.add_options()
+      ("help,h", "Show available options")
+      ("config,c", po::value<string>(), "Path to config file");
+
+  po::options_description general_options("General options");
+  general_options.add_options()
+      ("trees,t", po::value<string>()->required(),
+          "File containing source parse trees in .ptb format")
+      ("strings,s", po::value<string>()->required(),
+          "File containing target strings")
+      ("alignment,a", po::value<string>(),
+          "File containing alignments for GHKM")
+      ("internal,i", po::value<string>(),
+          "File containing internal state")
+      ("forward-prob", po::value<string>()->required(),
+          "Path to the IBM Model 1 translation table p(t|s)")
+      ("reverse-prob", po::value<string>()->required(),
+          "Path to the IBM Model 1 translation table p(s|t)")
+      ("threads", po::value<int>()->default_value(
+          max(1u, thread::hardware_concurrency())),
+          "Maximum number of threads, the sampler is run with 1, 2, 4, ... "
+          "threads up to this number")
+      ("iterations", po::value<int>()->default_value(3),
+          "Number of sampling iterations for each run")
+      ("seed", po::value<unsigned int>()->default_value(1),
+          "Seed for random generator")
+      ("alpha", po::value<double>()->default_value(1.0),
+          "Dirichlet process concentration parameter")
+      ("pexpand", po::value<double>()->default_value(0.0001),
+          "Param. for the Bernoulli distr. for a node to be split")
+      ("pchild", po::value<double>()->default_value(0.5),
+          "Param. for the geom. distr. for the number of children")
+      ("pterm", po::value<double>()->default_value(0.5),
+          "Param. for the geom. distr. for the number of target terminals")
+      ("pcfg", po::value<bool>()->default_value(true),
+          "Use MLE PCFG estimates in the base distribution for trees")
+      ("baseline", po::value<string>(),
+          "Baseline file with the throughput (nodes/sec) for each number of "
+          "threads")
+      ("max-regression", po::value<double>()->default_value(10),
+          "Maximum throughput drop (in percent) with respect to the baseline")
+      ("write-baseline", po::value<string>(),
+          "Write the measured throughput to this baseline file");
+
+  po::variables_map vm;
+  po::options_description cmdline_options;
+  cmdline_options.add(cmdline_specific).add(general_options);
+  po::store(po::parse_command_line(argc, argv, cmdline_options), vm);
+
+  if (vm.count("help")) {
+    cout << cmdline_options << endl;
+    return 0;
+  }
+
+  if (vm.count("config")) {
+    po::options_description config_options;
+    config_options.add(general_options);
+    ifstream config_stream(vm["config"].as<string>());
+    po::store(po::parse_config_file(config_stream, config_options), vm);
+  }
+
+  po::notify(vm);
+
+  if (!vm.count("alignment") && !vm.count("internal")) {
+    cerr << "Either --alignment or --internal must be specified" << endl;
+    return 1;
+  }
+
+  map<int, double> baseline;
+  if (vm.count("baseline")) {
+    ifstream baseline_stream(vm["baseline"].as<string>());
+    int num_threads;
+    double throughput;
+    while (baseline_stream >> num_threads >> throughput) {
+      baseline[num_threads] = throughput;
+    }
+  }
+
+  Dictionary dictionary;
+  shared_ptr<TranslationTable> forward_table, reverse_table;
+  LoadTranslationTables(vm, forward_table, reverse_table, dictionary);
+  auto training = make_shared<vector<Instance>>(
+      LoadTrainingData(vm, dictionary));
+  shared_ptr<PCFGTable> pcfg_table;
+  if (vm["pcfg"].as<bool>()) {
+    pcfg_table = make_shared<PCFGTable>(training);
+  }
+
+  // Every iteration samples all the nodes except the roots of the trees.
+  int iterations = vm["iterations"].as<int>();
+  long long num_sentences = 0, num_nodes = 0;
+  for (const Instance& instance: *training) {
+    if (instance.first.size() > 1) {
+      ++num_sentences;
+      num_nodes += instance.first.size() - 1;
+    }
+  }
+  num_sentences *= iterations;
+  num_nodes *= iterations;
+
+  vector<int> thread_counts;
+  int max_threads = vm["threads"].as<int>();
+  for (int num_threads = 1; num_threads < max_threads; num_threads *= 2) {
+    thread_counts.push_back(num_threads);
+  }
+  thread_counts.push_back(max_threads);
+
+  bool regression = false;
+  double single_thread_throughput = 0;
+  map<int, double> throughputs;
+  for (int num_threads: thread_counts) {
+    cerr << "Sampling with " << num_threads << " threads..." << endl;
+    ScalingResult result;
+    if (!RunSampler(vm, training, dictionary, pcfg_table, forward_table,
+                    reverse_table, num_threads, result)) {
+      cerr << "Sampling with " << num_threads << " threads failed" << endl;
+      return 1;
+    }
+
+    double total_time = result.sampling_time + result.synchronization_time;
+    double throughput = num_nodes / total_time;
+    throughputs[num_threads] = throughput;
+    if (num_threads == 1) {
+      single_thread_throughput = throughput;
+    }
+
+    cout << "{\"threads\": " << num_threads
+         << ", \"seconds\": " << total_time
+         << ", \"nodes_per_second\": " << throughput
+         << ", \"sentences_per_second\": " << num_sentences / total_time
+         << ", \"sync_fraction\": "
+         << result.synchronization_time / total_time
+         << ", \"peak_rss_mb\": " << result.peak_rss / (1024.0 * 1024.0)
+         << ", \"efficiency\": "
+         << throughput / (num_threads * single_thread_throughput);
+    if (baseline.count(num_threads)) {
+      double change = 100 * (throughput / baseline[num_threads] - 1);
+      cout << ", \"baseline_change_percent\": " << change;
+      if (change < -vm["max-regression"].as<double>()) {
+        regression = true;
+      }
+    }
+    cout << "}" << endl;
+  }
+
+  if (vm.count("write-baseline")) {
+    ofstream baseline_stream(vm["write-baseline"].as<string>());
+    for (const auto& entry: throughputs) {
+      baseline_stream << entry.first << " " << entry.second << "\n";
+    }
+  }
+
+  if (regression) {
+    cerr << "Throughput dropped by more than "
+         << vm["max-regression"].as<double>() << "% against the baseline"
+         << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "log_add.h"
+
+using namespace std;
+
+// Semirings for the inside pass of Reorderer. Scores are log probabilities:
+// the score of a match is the log probability of its rule plus the inside
+// scores of its frontier nodes, and the semiring decides how the matches of a
+// node are summed up and which information about them is kept.
+//
+// A semiring defines a Value type and the static functions
+//   Value Zero();
+//   Value FromMatch(double score, int match_index);
+//   void Plus(Value& sum, const Value& value);
+//   double GetScore(const Value& value);
+// where match_index is -1 for nodes without matching rules.
+
+// Keeps the best match of every node, as a back-pointer for reconstructing the
+// max derivation.
+struct ViterbiSemiring {
+  struct Value {
+    double score;
+    int match_index;
+  };
+
+  static Value Zero() {
+    Value value;
+    value.score = Log<double>::zero();
+    value.match_index = -1;
+    return value;
+  }
+
+  static Value FromMatch(double score, int match_index) {
+    Value value;
+    value.score = score;
+    value.match_index = match_index;
+    return value;
+  }
+
+  // The first of several equally good matches is kept.
+  static void Plus(Value& sum, const Value& value) {
+    if (value.score > sum.score) {
+      sum = value;
+    }
+  }
+
+  static double GetScore(const Value& value) {
+    return value.score;
+  }
+};
+
+// Sums over all the derivations, for sampling from the posterior.
+struct LogSemiring {
+  typedef double Value;
+
+  static Value Zero() {
+    return Log<double>::zero();
+  }
+
+  static Value FromMatch(double score, int match_index) {
+    return score;
+  }
+
+  static void Plus(Value& sum, const Value& value) {
+    sum = Log<double>::add(sum, value);
+  }
+
+  static double GetScore(const Value& value) {
+    return value;
+  }
+};
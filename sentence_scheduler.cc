@@ -0,0 +1,54 @@
+#include "sentence_scheduler.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
+
+SentenceScheduler::SentenceScheduler(
+    const shared_ptr<vector<Instance>>& training) :
+    costs(training->size()) {
+  for (size_t i = 0; i < training->size(); ++i) {
+    costs[i] = EstimateCost((*training)[i]);
+  }
+}
+
+double SentenceScheduler::EstimateCost(const Instance& instance) const {
+  // Parse failures are skipped by the sampler.
+  const AlignedTree& tree = instance.first;
+  if (tree.size() <= 1) {
+    return 0;
+  }
+
+  // Each node is resampled once and the number of legal spans for a node is
+  // quadratic in the length of the target span of its ancestor.
+  double target_size = instance.second.size();
+  return tree.size() * (target_size + 1) * (target_size + 1);
+}
+
+void SentenceScheduler::UpdateCost(int index, double duration) {
+  costs[index] = duration;
+}
+
+int SentenceScheduler::GetCostBucket(int index) const {
+  if (costs[index] <= 0) {
+    return INT_MIN;
+  }
+  return ilogb(costs[index]);
+}
+
+vector<int> SentenceScheduler::GetSchedule(
+    int start_index, int end_index) const {
+  vector<int> schedule(end_index - start_index);
+  iota(schedule.begin(), schedule.end(), start_index);
+  random_shuffle(schedule.begin(), schedule.end());
+
+  // Longest first, but only up to a factor of 2 so that the order of the
+  // sentences remains randomized.
+  stable_sort(schedule.begin(), schedule.end(),
+      [this](int index1, int index2) -> bool {
+        return GetCostBucket(index1) > GetCostBucket(index2);
+      });
+
+  return schedule;
+}
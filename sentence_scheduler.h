@@ -0,0 +1,29 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "definitions.h"
+
+using namespace std;
+
+// Orders the sentences for a sampling sweep such that the expensive sentences
+// are dispatched first and the threads finish at roughly the same time.
+// Sentences with similar costs are visited in random order. Costs are estimated
+// from the size of the trees until the time required to sample a sentence has
+// been measured.
+class SentenceScheduler {
+ public:
+  SentenceScheduler(const shared_ptr<vector<Instance>>& training);
+
+  vector<int> GetSchedule(int start_index, int end_index) const;
+
+  void UpdateCost(int index, double duration);
+
+ private:
+  double EstimateCost(const Instance& instance) const;
+
+  int GetCostBucket(int index) const;
+
+  vector<double> costs;
+};
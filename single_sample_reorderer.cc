@@ -8,34 +8,42 @@ SingleSampleReorderer::SingleSampleReorderer(
     shared_ptr<RuleStatsReporter> reporter,
     RandomGenerator& generator) :
     Reorderer(tree, grammar, reporter),
-    generator(generator),
-    uniform_distribution(0, 1) {
-  ConstructProbabilityCache();
+    generator(generator) {}
+
+String SingleSampleReorderer::SampleReordering(
+    RandomGenerator& generator) const {
+  auto select = [this, &generator](int node, double& match_prob) {
+    return SampleRule(node, generator, match_prob);
+  };
+  return ConstructReordering(select);
 }
 
-void SingleSampleReorderer::Combine(double& cache_prob, double match_prob) {
-  cache_prob = Log<double>::add(cache_prob, match_prob);
+int SingleSampleReorderer::SelectRule(int node, double& match_prob) {
+  return SampleRule(node, generator, match_prob);
 }
 
-shared_ptr<pair<Rule, double>> SingleSampleReorderer::SelectRule(
-    const vector<pair<Rule, double>>& candidates) {
+int SingleSampleReorderer::SampleRule(
+    int node, RandomGenerator& generator, double& match_prob) const {
+  vector<double> candidates = GetMatchProbs(node);
   if (candidates.size() == 0) {
-    return nullptr;
+    return -1;
   }
 
   double total_prob = Log<double>::zero();
-  for (auto rule: candidates) {
-    total_prob = Log<double>::add(total_prob, rule.second);
+  for (double prob: candidates) {
+    total_prob = Log<double>::add(total_prob, prob);
   }
 
+  uniform_real_distribution<double> uniform_distribution(0, 1);
   double r = log(uniform_distribution(generator)) + total_prob;
-  for (auto rule: candidates) {
-    if (rule.second >= r) {
-      return make_shared<pair<Rule, double>>(rule);
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (candidates[i] >= r) {
+      match_prob = candidates[i];
+      return i;
     }
-    r = Log<double>::subtract(r, rule.second);
+    r = Log<double>::subtract(r, candidates[i]);
   }
 
   assert(false);
-  return nullptr;
+  return -1;
 }
@@ -9,7 +9,7 @@ using namespace std;
 
 typedef mt19937 RandomGenerator;
 
-class SingleSampleReorderer: public Reorderer {
+class SingleSampleReorderer: public Reorderer<LogSemiring> {
  public:
   SingleSampleReorderer(
       const AlignedTree& tree,
@@ -17,14 +17,17 @@ class SingleSampleReorderer: public Reorderer {
       shared_ptr<RuleStatsReporter> reporter,
       RandomGenerator& generator);
 
+  // Draws a reordering with the given generator instead of the one of the
+  // reorderer. Safe to call from several threads with different generators.
+  String SampleReordering(RandomGenerator& generator) const;
+
  private:
-  void Combine(double& cache_prob, double match_prob);
+  int SelectRule(int node, double& match_prob);
 
-  shared_ptr<pair<Rule, double>> SelectRule(
-      const vector<pair<Rule, double>>& candidates);
+  int SampleRule(int node, RandomGenerator& generator,
+                 double& match_prob) const;
 
   RandomGenerator& generator;
-  uniform_real_distribution<double> uniform_distribution;
 };
 
 #endif
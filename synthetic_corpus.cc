@@ -0,0 +1,149 @@
+#include "synthetic_corpus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+SyntheticCorpus::SyntheticCorpus(
+    int num_tags, int vocabulary_size, int max_depth, double swap_prob,
+    double null_prob, unsigned int seed) :
+    num_tags(num_tags), vocabulary_size(vocabulary_size),
+    max_depth(max_depth), swap_prob(swap_prob), null_prob(null_prob),
+    seed(seed), generator(seed), uniform_distribution(0, 1) {}
+
+int SyntheticCorpus::GetRandomIndex(int size) {
+  // Log-uniform values, i.e. index i is drawn with probability ~ 1 / (i + 1).
+  int index = pow(size + 1, uniform_distribution(generator)) - 1;
+  return min(index, size - 1);
+}
+
+SyntheticSentence SyntheticCorpus::GenerateSentence(int length) {
+  vector<int> source_words(length);
+  for (int i = 0; i < length; ++i) {
+    source_words[i] = GetRandomIndex(vocabulary_size);
+  }
+
+  ostringstream tree_out;
+  vector<int> target_order;
+  GenerateSubtree(0, length, 0, source_words, tree_out, target_order);
+
+  ostringstream source_out;
+  for (int word: source_words) {
+    source_out << "s" << word << " ";
+  }
+
+  ostringstream string_out, alignment_out;
+  int target_size = 0, aligned_words = 0;
+  for (int source_index: target_order) {
+    if (uniform_distribution(generator) < null_prob) {
+      string_out << "t" << GetRandomIndex(vocabulary_size) << " ";
+      ++target_size;
+    }
+
+    // Keep at least one link, the readers skip empty alignment lines.
+    if (uniform_distribution(generator) < null_prob && aligned_words > 0) {
+      continue;
+    }
+    string_out << "t" << source_words[source_index] << " ";
+    alignment_out << source_index << "-" << target_size << " ";
+    ++target_size;
+    ++aligned_words;
+  }
+
+  SyntheticSentence sentence;
+  sentence.tree = tree_out.str();
+  sentence.source_string = source_out.str();
+  sentence.target_string = string_out.str();
+  sentence.alignment = alignment_out.str();
+  return sentence;
+}
+
+void SyntheticCorpus::GenerateSubtree(
+    int start, int length, int depth, const vector<int>& source_words,
+    ostream& out, vector<int>& target_order) {
+  if (length == 1) {
+    out << "(P" << GetRandomIndex(num_tags) << " s" << source_words[start]
+        << ")";
+    target_order.push_back(start);
+    return;
+  }
+
+  out << "(X" << GetRandomIndex(num_tags);
+  vector<int> child_lengths;
+  if (depth + 1 >= max_depth) {
+    // Flat constituent over preterminals.
+    child_lengths.assign(length, 1);
+  } else {
+    int num_children = min(length, uniform_distribution(generator) < 0.7 ?
+                                   2 : 3);
+    // Choose the boundaries between the children at random.
+    vector<int> boundaries;
+    for (int i = 1; i < length; ++i) {
+      boundaries.push_back(i);
+    }
+    shuffle(boundaries.begin(), boundaries.end(), generator);
+    boundaries.resize(num_children - 1);
+    boundaries.push_back(0);
+    boundaries.push_back(length);
+    sort(boundaries.begin(), boundaries.end());
+    for (int i = 0; i < num_children; ++i) {
+      child_lengths.push_back(boundaries[i + 1] - boundaries[i]);
+    }
+  }
+
+  vector<vector<int>> child_orders(child_lengths.size());
+  for (size_t i = 0; i < child_lengths.size(); ++i) {
+    out << " ";
+    GenerateSubtree(start, child_lengths[i], depth + 1, source_words, out,
+                    child_orders[i]);
+    start += child_lengths[i];
+  }
+  out << ")";
+
+  if (uniform_distribution(generator) < swap_prob) {
+    reverse(child_orders.begin(), child_orders.end());
+  }
+  for (const auto& child_order: child_orders) {
+    target_order.insert(target_order.end(),
+                        child_order.begin(), child_order.end());
+  }
+}
+
+void SyntheticCorpus::WriteTranslationTable(
+    ostream& out, bool reversed) const {
+  // Use a separate generator such that the tables do not depend on the number
+  // of generated sentences.
+  mt19937 table_generator(seed);
+  uniform_int_distribution<int> word_distribution(0, vocabulary_size - 1);
+  for (int word = 0; word < vocabulary_size; ++word) {
+    // The random translations are redrawn if they repeat a target word, since
+    // a repeated (s, t) entry would replace the earlier entry when loaded.
+    vector<pair<int, double>> translations;
+    translations.push_back(make_pair(word, 0.7));
+    for (double prob: {0.2, 0.1}) {
+      if ((int) translations.size() >= vocabulary_size) {
+        break;
+      }
+
+      int target_word;
+      bool repeated;
+      do {
+        target_word = word_distribution(table_generator);
+        repeated = false;
+        for (const auto& translation: translations) {
+          repeated |= translation.first == target_word;
+        }
+      } while (repeated);
+      translations.push_back(make_pair(target_word, prob));
+    }
+
+    for (const auto& translation: translations) {
+      if (reversed) {
+        out << "t" << translation.first << " s" << word;
+      } else {
+        out << "s" << word << " t" << translation.first;
+      }
+      out << " " << log(translation.second) << "\n";
+    }
+  }
+}
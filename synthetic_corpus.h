@@ -0,0 +1,51 @@
+#pragma once
+
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// A sentence pair in the text formats read by the tools: a parse tree in .ptb
+// format, its leaves, a target sentence and a word alignment ("i-j" links).
+struct SyntheticSentence {
+  string tree;
+  string source_string;
+  string target_string;
+  string alignment;
+};
+
+// Generates random parallel sentences for performance testing without real
+// data. Tags and words follow a Zipf-like distribution. Every source word is
+// translated by its own target word, the children of random constituents are
+// swapped on the target side and some words are left unaligned on both sides.
+class SyntheticCorpus {
+ public:
+  SyntheticCorpus(int num_tags, int vocabulary_size, int max_depth,
+                  double swap_prob, double null_prob, unsigned int seed);
+
+  SyntheticSentence GenerateSentence(int length);
+
+  // Writes the translation table p(t|s) (or p(s|t) if reversed) in the format
+  // expected by TranslationTable.
+  void WriteTranslationTable(ostream& out, bool reversed) const;
+
+ private:
+  // Writes the subtree covering the source words [start, start + length) and
+  // appends the source indexes in target order.
+  void GenerateSubtree(int start, int length, int depth,
+                       const vector<int>& source_words, ostream& out,
+                       vector<int>& target_order);
+
+  int GetRandomIndex(int size);
+
+  int num_tags;
+  int vocabulary_size;
+  int max_depth;
+  double swap_prob;
+  double null_prob;
+  unsigned int seed;
+  mt19937 generator;
+  uniform_real_distribution<double> uniform_distribution;
+};
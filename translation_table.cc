@@ -3,6 +3,7 @@
 #include <cmath>
 
 #include "dictionary.h"
+#include "memory_util.h"
 
 const double TranslationTable::DEFAULT_NULL_PROB = 1e-2;
 
@@ -55,6 +56,21 @@ double TranslationTable::ComputeAverageLogProbability(
   return result;
 }
 
+double TranslationTable::ComputeAverageLogProbability(
+    const vector<int>& source_words,
+    const vector<int>& target_words) const {
+  double result = 0;
+  for (auto target_word: target_words) {
+    double best = GetProbability(Dictionary::NULL_WORD_ID, target_word);
+    for (auto source_word: source_words) {
+      best = max(best, GetProbability(source_word, target_word));
+    }
+    result += log(best);
+  }
+
+  return result;
+}
+
 double TranslationTable::GetProbability(
     int source_word, int target_word) const {
   if (source_word == Dictionary::NULL_WORD_ID) {
@@ -68,3 +84,18 @@ double TranslationTable::GetProbability(
 
   return 0;
 }
+
+long long TranslationTable::GetTableMemoryUsage() const {
+  return GetMemoryUsage(table);
+}
+
+long long TranslationTable::GetCacheMemoryUsage() const {
+  long long memory_usage = cache.capacity() * sizeof(vector<vector<double>>);
+  for (const auto& sentence_cache: cache) {
+    memory_usage += sentence_cache.capacity() * sizeof(vector<double>);
+    for (const auto& target_cache: sentence_cache) {
+      memory_usage += target_cache.capacity() * sizeof(double);
+    }
+  }
+  return memory_usage;
+}
@@ -28,8 +28,20 @@ class TranslationTable {
       const vector<int>& target_indexes,
       int thread_id);
 
+  // Same as above, but looks up the words directly in the table instead of
+  // using the cache of the current sentence.
+  double ComputeAverageLogProbability(
+      const vector<int>& source_words,
+      const vector<int>& target_words) const;
+
   double GetProbability(int source_word, int target_word) const;
 
+  // Approximate memory used by the translation probabilities.
+  long long GetTableMemoryUsage() const;
+
+  // Approximate memory used by the caches of the current sentences.
+  long long GetCacheMemoryUsage() const;
+
   static const double DEFAULT_NULL_PROB;
 
  private:
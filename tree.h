@@ -81,8 +81,10 @@ class tree {
 		tree(const T&);
 		tree(const iterator_base&);
 		tree(const tree<T, tree_node_allocator>&);
+		tree(tree<T, tree_node_allocator>&&);
 		~tree();
 		tree<T,tree_node_allocator>& operator=(const tree<T, tree_node_allocator>&);
+		tree<T,tree_node_allocator>& operator=(tree<T, tree_node_allocator>&&);
 
       /// Base class for iterators, only pointers stored, no traversal logic.
 #ifdef __SGI_STL_PORT
@@ -415,6 +417,7 @@ class tree {
 		tree_node_allocator alloc_;
 		void head_initialise_();
 		void copy_(const tree<T, tree_node_allocator>& other);
+		void move_nodes_(tree<T, tree_node_allocator>& x);
 
       /// Comparator class for two nodes of a tree (used for sorting and searching).
 		template<class StrictWeakOrdering>
@@ -533,6 +536,16 @@ tree<T,tree_node_allocator>& tree<T, tree_node_allocator>::operator=(const tree<
 	return *this;
 	}
 
+template <class T, class tree_node_allocator>
+tree<T,tree_node_allocator>& tree<T, tree_node_allocator>::operator=(tree<T, tree_node_allocator>&& x)
+	{
+	if(this != &x) {
+		clear();
+		move_nodes_(x);
+		}
+	return *this;
+	}
+
 template <class T, class tree_node_allocator>
 tree<T, tree_node_allocator>::tree(const tree<T, tree_node_allocator>& other)
 	{
@@ -540,6 +553,28 @@ tree<T, tree_node_allocator>::tree(const tree<T, tree_node_allocator>& other)
 	copy_(other);
 	}
 
+template <class T, class tree_node_allocator>
+tree<T, tree_node_allocator>::tree(tree<T, tree_node_allocator>&& x)
+	{
+	head_initialise_();
+	move_nodes_(x);
+	}
+
+// Relinks the top level nodes of x between our head and feet, leaving x empty.
+// The top level nodes have no parent, so no other pointers need updating.
+template <class T, class tree_node_allocator>
+void tree<T, tree_node_allocator>::move_nodes_(tree<T, tree_node_allocator>& x)
+	{
+	if(x.head->next_sibling!=x.feet) {
+		head->next_sibling=x.head->next_sibling;
+		feet->prev_sibling=x.feet->prev_sibling;
+		x.head->next_sibling->prev_sibling=head;
+		x.feet->prev_sibling->next_sibling=feet;
+		x.head->next_sibling=x.feet;
+		x.feet->prev_sibling=x.head;
+		}
+	}
+
 template <class T, class tree_node_allocator>
 void tree<T, tree_node_allocator>::copy_(const tree<T, tree_node_allocator>& other)
 	{
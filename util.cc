@@ -12,6 +12,7 @@
 #include <boost/regex.hpp>
 
 #include "aligned_tree.h"
+#include "binary_io.h"
 #include "dictionary.h"
 #include "translation_table.h"
 
@@ -32,8 +33,8 @@ AlignedTree ReadParseTree(istream& tree_stream, Dictionary& dictionary) {
   int word_index = 0;
   // TODO(pauldb): Replace with std::regex and std::sregex_token_iterator when
   // g++ will support both.
-  boost::regex var_index("#[0-9]+");
-  boost::regex token("[()]|[^\\s()][^\\s]*[^\\s()]|[^\\s()]+");
+  static const boost::regex var_index("#[0-9]+");
+  static const boost::regex token("[()]|[^\\s()][^\\s]*[^\\s()]|[^\\s()]+");
   boost::sregex_token_iterator begin(line.begin(), line.end(), token), end;
   stack<AlignedTree::iterator> st;
   for (auto it = begin; it != end; ++it) {
@@ -83,7 +84,7 @@ String ReadTargetString(istream& string_stream, Dictionary& dictionary) {
   getline(string_stream, line);
 
   istringstream iss(line);
-  boost::regex var_index("#[0-9]+");
+  static const boost::regex var_index("#[0-9]+");
   string word;
   int word_index = 0;
   while (iss >> word) {
@@ -103,7 +104,7 @@ pair<Rule, double> ReadRule(istream& grammar_stream, Dictionary& dictionary) {
   string line;
   getline(grammar_stream, line);
 
-  boost::regex separator("\\|\\|\\|");
+  static const boost::regex separator("\\|\\|\\|");
   boost::sregex_token_iterator it(line.begin(), line.end(), separator, -1);
 
   // Ignore root tag.
@@ -123,7 +124,7 @@ istream& operator>>(istream& in, Alignment& alignment) {
   string line;
   getline(in, line);
 
-  boost::regex number("[0-9]+");
+  static const boost::regex number("[0-9]+");
   boost::sregex_token_iterator it(line.begin(), line.end(), number), end;
   while (it != end) {
     int x = stoi(*(it++));
@@ -264,6 +265,77 @@ ostream& operator<<(ostream& out, const Alignment& alignment) {
   return out;
 }
 
+static void WriteBinaryNode(
+    ostream& out, const AlignedTree& tree, const NodeIter& node) {
+  auto span = node->GetSpan();
+  WriteBinary<int32_t>(out, node->GetTag());
+  WriteBinary<int32_t>(out, node->GetWord());
+  WriteBinary<int32_t>(out, node->GetWordIndex());
+  WriteBinary<int32_t>(out, span.first);
+  WriteBinary<int32_t>(out, span.second);
+  WriteBinary<int8_t>(out, node->IsSplitNode());
+  WriteBinary<int32_t>(out, node.number_of_children());
+  for (auto child = tree.begin(node); child != tree.end(node); ++child) {
+    WriteBinaryNode(out, tree, child);
+  }
+}
+
+void WriteBinaryRule(ostream& out, const Rule& rule) {
+  WriteBinaryNode(out, rule.first, rule.first.begin());
+
+  const String& target_string = rule.second;
+  WriteBinary<int32_t>(out, target_string.size());
+  for (const auto& node: target_string) {
+    WriteBinary<int32_t>(out, node.GetWord());
+    WriteBinary<int32_t>(out, node.GetWordIndex());
+    WriteBinary<int32_t>(out, node.GetVarIndex());
+  }
+}
+
+static void ReadBinaryNode(
+    istream& in, AlignedTree& tree, const NodeIter& parent) {
+  int32_t tag, word, word_index, start, end, num_children;
+  int8_t split_node;
+  ReadBinary(in, tag);
+  ReadBinary(in, word);
+  ReadBinary(in, word_index);
+  ReadBinary(in, start);
+  ReadBinary(in, end);
+  ReadBinary(in, split_node);
+  ReadBinary(in, num_children);
+
+  AlignedNode value;
+  value.SetTag(tag);
+  value.SetWord(word);
+  value.SetWordIndex(word_index);
+  value.SetSpan(make_pair(start, end));
+  value.SetSplitNode(split_node);
+
+  NodeIter node = tree.empty() ?
+      tree.insert(tree.begin(), value) : tree.append_child(parent, value);
+  for (int i = 0; i < num_children; ++i) {
+    ReadBinaryNode(in, tree, node);
+  }
+}
+
+Rule ReadBinaryRule(istream& in) {
+  AlignedTree tree;
+  ReadBinaryNode(in, tree, tree.begin());
+
+  int32_t size;
+  ReadBinary(in, size);
+  String target_string;
+  for (int i = 0; i < size; ++i) {
+    int32_t word, word_index, var_index;
+    ReadBinary(in, word);
+    ReadBinary(in, word_index);
+    ReadBinary(in, var_index);
+    target_string.push_back(StringNode(word, word_index, var_index));
+  }
+
+  return make_pair(tree, target_string);
+}
+
 string GetOutputFilename(
     const string& output_directory,
     const string& extension,
@@ -325,3 +397,49 @@ vector<Instance> LoadInternalState(
 
   return training;
 }
+
+vector<Instance> LoadTrainingData(
+    po::variables_map vm, Dictionary& dictionary) {
+  if (vm.count("internal")) {
+    return LoadInternalState(vm, dictionary);
+  }
+
+  cerr << "Reading parse trees..." << endl;
+  vector<AlignedTree> parse_trees;
+  ifstream tree_stream(vm["trees"].as<string>());
+  while (!tree_stream.eof()) {
+    parse_trees.push_back(ReadParseTree(tree_stream, dictionary));
+    tree_stream >> ws;
+  }
+  cerr << "Done..." << endl;
+
+  cerr << "Reading target strings..." << endl;
+  vector<String> target_strings;
+  ifstream string_stream(vm["strings"].as<string>());
+  while (!string_stream.eof()) {
+    target_strings.push_back(ReadTargetString(string_stream, dictionary));
+    string_stream >> ws;
+  }
+  cerr << "Done..." << endl;
+
+  cerr << "Reading alignments..." << endl;
+  vector<Alignment> alignments;
+  ifstream alignment_stream(vm["alignment"].as<string>());
+  while (!alignment_stream.eof()) {
+    Alignment alignment;
+    alignment_stream >> alignment >> ws;
+    alignments.push_back(alignment);
+  }
+  cerr << "Done..." << endl;
+
+  assert(parse_trees.size() == target_strings.size() &&
+         parse_trees.size() == alignments.size());
+
+  vector<Instance> training(parse_trees.size());
+  for (size_t i = 0; i < training.size(); ++i) {
+    training[i] = ConstructInstance(
+        parse_trees[i], target_strings[i], alignments[i]);
+  }
+
+  return training;
+}
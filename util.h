@@ -47,6 +47,12 @@ void WriteSTSGRule(ostream& out, const Rule& rule, Dictionary& dictionary);
 
 ostream& operator<<(ostream& out, const Alignment& alignment);
 
+// Binary serialization of rules, used to exchange rules between processes and
+// to store them on disk. All fields of the nodes are preserved.
+void WriteBinaryRule(ostream& out, const Rule& rule);
+
+Rule ReadBinaryRule(istream& in);
+
 string GetOutputFilename(
   const string& output_directory,
   const string& extension,
@@ -61,4 +67,9 @@ void LoadTranslationTables(
 vector<Instance> LoadInternalState(
     po::variables_map vm, Dictionary& dictionary);
 
+// Loads the internal state if available, otherwise constructs the GHKM
+// derivations of the training instances from the alignments.
+vector<Instance> LoadTrainingData(
+    po::variables_map vm, Dictionary& dictionary);
+
 #endif
@@ -4,25 +4,11 @@ ViterbiReorderer::ViterbiReorderer(
     const AlignedTree& tree,
     const Grammar& grammar,
     shared_ptr<RuleStatsReporter> reporter) :
-    Reorderer(tree, grammar, reporter) {
-  ConstructProbabilityCache();
-}
-
-void ViterbiReorderer::Combine(double& cache_prob, double match_prob) {
-  cache_prob = max(cache_prob, match_prob);
-}
-
-shared_ptr<pair<Rule, double>> ViterbiReorderer::SelectRule(
-    const vector<pair<Rule, double>>& candidates) {
-  if (candidates.size() == 0) {
-    return nullptr;
-  }
+    Reorderer(tree, grammar, reporter) {}
 
-  pair<Rule, double> max_rule = candidates.front();
-  for (auto rule: candidates) {
-    if (rule.second > max_rule.second) {
-      max_rule = rule;
-    }
-  }
-  return make_shared<pair<Rule, double>>(max_rule);
+// The inside value of a node holds the back-pointer to its best match.
+int ViterbiReorderer::SelectRule(int node, double& match_prob) {
+  const Value& value = GetInsideValue(node);
+  match_prob = value.score;
+  return value.match_index;
 }
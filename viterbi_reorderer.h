@@ -5,7 +5,7 @@
 
 using namespace std;
 
-class ViterbiReorderer: public Reorderer {
+class ViterbiReorderer: public Reorderer<ViterbiSemiring> {
  public:
   ViterbiReorderer(
       const AlignedTree& tree,
@@ -13,10 +13,7 @@ class ViterbiReorderer: public Reorderer {
       shared_ptr<RuleStatsReporter> reporter);
 
  private:
-  void Combine(double& cache_prob, double match_prob);
-
-  shared_ptr<pair<Rule, double>> SelectRule(
-      const vector<pair<Rule, double>>& candidates);
+  int SelectRule(int node, double& match_prob);
 };
 
 #endif
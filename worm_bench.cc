@@ -0,0 +1,414 @@
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "aligned_tree.h"
+#include "alignment_constructor.h"
+#include "dictionary.h"
+#include "grammar.h"
+#include "indexed_tree.h"
+#include "restaurant_process.h"
+#include "rule_extractor.h"
+#include "rule_matcher.h"
+#include "rule_reorderer.h"
+#include "rule_stats_reporter.h"
+#include "synthetic_corpus.h"
+#include "time_util.h"
+#include "translation_table.h"
+#include "util.h"
+#include "viterbi_reorderer.h"
+
+using namespace std;
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+// Accumulates the results of the kernels such that they are not optimized
+// away.
+static double sink = 0;
+
+// Runs the kernel until at least min_time seconds have passed and writes the
+// average time per operation as a JSON object. The kernel must return the
+// number of operations it performed.
+void RunBenchmark(ostream& out, const string& name, int sentence_length,
+                  int fragment_size, double min_time,
+                  const function<long long()>& kernel) {
+  // Warm up.
+  kernel();
+
+  int runs = 0;
+  long long operations = 0;
+  double duration = 0;
+  auto start_time = GetTime();
+  while (duration < min_time) {
+    operations += kernel();
+    ++runs;
+    duration = duration_cast<microseconds>(
+        GetTime() - start_time).count() / 1e6;
+  }
+
+  out << "{\"benchmark\": \"" << name << "\""
+      << ", \"sentence_length\": " << sentence_length
+      << ", \"fragment_size\": " << fragment_size
+      << ", \"runs\": " << runs
+      << ", \"operations\": " << operations
+      << ", \"seconds\": " << duration
+      << ", \"ns_per_operation\": " << 1e9 * duration / operations
+      << "}" << endl;
+}
+
+// Joins the minimal GHKM rules into larger fragments by unsplitting the nodes
+// whose fragments have less than min_fragment_size nodes. Returns the number of
+// nodes the subtree adds to the fragment of its parent.
+int MergeFragments(AlignedTree& tree, const NodeIter& node,
+                   int min_fragment_size) {
+  int fragment_size = 1;
+  for (auto child = tree.begin(node); child != tree.end(node); ++child) {
+    fragment_size += MergeFragments(tree, child, min_fragment_size);
+  }
+
+  if (!node->IsSplitNode() || node == tree.begin()) {
+    return fragment_size;
+  }
+
+  if (fragment_size < min_fragment_size) {
+    node->SetSplitNode(false);
+    node->SetSpan(make_pair(-1, -1));
+    return fragment_size;
+  }
+
+  return 0;
+}
+
+void WriteGrammar(const vector<Rule>& rules, Dictionary& dictionary,
+                  AlignmentConstructor& alignment_constructor,
+                  const string& grammar_file, const string& alignment_file) {
+  map<Rule, int> rule_counts;
+  map<int, int> total_counts;
+  for (const Rule& rule: rules) {
+    ++rule_counts[rule];
+    ++total_counts[rule.first.GetRootTag()];
+  }
+
+  ofstream grammar_stream(grammar_file);
+  ofstream alignment_stream(alignment_file);
+  for (const auto& entry: rule_counts) {
+    const Rule& rule = entry.first;
+    double rule_prob =
+        (double) entry.second / total_counts[rule.first.GetRootTag()];
+    WriteSTSGRule(grammar_stream, rule, dictionary);
+    grammar_stream << " ||| " << rule_prob << "\n";
+    alignment_stream << alignment_constructor.ConstructAlignments(rule).first
+                     << "\n";
+  }
+}
+
+int main(int argc, char** argv) {
+  po::options_description cmdline_specific("Command line options");
+  cmdline_specific.add_options()
+      ("help,h", "Show available options")
+      ("config,c", po::value<string>(), "Path to config file");
+
+  po::options_description general_options("General options");
+  general_options.add_options()
+      ("lengths", po::value<vector<int>>()->multitoken()
+          ->default_value(vector<int>{10, 20, 40}, "10 20 40"),
+          "Sentence lengths of the synthetic corpora")
+      ("fragment-sizes", po::value<vector<int>>()->multitoken()
+          ->default_value(vector<int>{1, 4, 8}, "1 4 8"),
+          "Minimum number of nodes in the fragments of the derivations (1 for "
+          "minimal GHKM rules)")
+      ("sentences", po::value<int>()->default_value(200),
+          "Number of sentences for each sentence length")
+      ("tags", po::value<int>()->default_value(20),
+          "Number of distinct nonterminals and preterminals")
+      ("vocabulary", po::value<int>()->default_value(10000),
+          "Number of distinct words in each language")
+      ("min-time", po::value<double>()->default_value(0.5),
+          "Minimum running time (in seconds) for each benchmark")
+      ("seed", po::value<unsigned int>()->default_value(0),
+          "Seed for generating the synthetic corpora")
+      ("output,o", po::value<string>(),
+          "Output file for the results (one JSON object per line), stdout if "
+          "not set");
+
+  po::variables_map vm;
+  po::options_description cmdline_options;
+  cmdline_options.add(cmdline_specific).add(general_options);
+  po::store(po::parse_command_line(argc, argv, cmdline_options), vm);
+
+  if (vm.count("help")) {
+    cout << cmdline_options << endl;
+    return 0;
+  }
+
+  if (vm.count("config")) {
+    po::options_description config_options;
+    config_options.add(general_options);
+    ifstream config_stream(vm["config"].as<string>());
+    po::store(po::parse_config_file(config_stream, config_options), vm);
+  }
+
+  po::notify(vm);
+
+  ofstream output_stream;
+  if (vm.count("output")) {
+    output_stream.open(vm["output"].as<string>());
+  }
+  ostream& out = vm.count("output") ? output_stream : cout;
+
+  int num_sentences = vm["sentences"].as<int>();
+  double min_time = vm["min-time"].as<double>();
+  SyntheticCorpus corpus(vm["tags"].as<int>(), vm["vocabulary"].as<int>(),
+                         numeric_limits<int>::max(), 0.3, 0.1,
+                         vm["seed"].as<unsigned int>());
+
+  fs::path temp_directory =
+      fs::temp_directory_path() / fs::unique_path("worm-bench-%%%%-%%%%");
+  fs::create_directories(temp_directory);
+  string forward_file = (temp_directory / "fwd").string();
+  string reverse_file = (temp_directory / "rev").string();
+  string grammar_file = (temp_directory / "grammar").string();
+  string alignment_file = (temp_directory / "alignment").string();
+  {
+    ofstream forward_stream(forward_file);
+    corpus.WriteTranslationTable(forward_stream, false);
+    ofstream reverse_stream(reverse_file);
+    corpus.WriteTranslationTable(reverse_stream, true);
+  }
+
+  // Every sentence has its own cache slot such that all sentences can be
+  // cached upfront.
+  Dictionary dictionary;
+  ifstream forward_stream(forward_file), reverse_stream(reverse_file);
+  auto forward_table = make_shared<TranslationTable>(
+      forward_stream, dictionary, false, num_sentences);
+  auto reverse_table = make_shared<TranslationTable>(
+      reverse_stream, dictionary, true, num_sentences);
+  AlignmentConstructor alignment_constructor(forward_table, reverse_table);
+  RuleExtractor extractor;
+  RuleReorderer rule_reorderer(0.1, 5, 8);
+
+  for (int length: vm["lengths"].as<vector<int>>()) {
+    vector<string> tree_lines;
+    vector<Instance> ghkm_instances;
+    for (int i = 0; i < num_sentences; ++i) {
+      SyntheticSentence sentence = corpus.GenerateSentence(length);
+      tree_lines.push_back(sentence.tree);
+
+      istringstream tree_stream(sentence.tree);
+      istringstream string_stream(sentence.target_string);
+      istringstream alignment_stream(sentence.alignment);
+      AlignedTree tree = ReadParseTree(tree_stream, dictionary);
+      String target_string = ReadTargetString(string_stream, dictionary);
+      Alignment alignment;
+      alignment_stream >> alignment;
+      ghkm_instances.push_back(
+          ConstructInstance(tree, target_string, alignment));
+    }
+
+    RunBenchmark(out, "read_parse_tree", length, 0, min_time, [&]() {
+      for (const string& line: tree_lines) {
+        istringstream tree_stream(line);
+        sink += ReadParseTree(tree_stream, dictionary).size();
+      }
+      return (long long) tree_lines.size();
+    });
+
+    vector<vector<int>> source_words(num_sentences);
+    vector<vector<int>> target_words(num_sentences);
+    for (int i = 0; i < num_sentences; ++i) {
+      const Instance& instance = ghkm_instances[i];
+      for (auto leaf = instance.first.begin_leaf();
+           leaf != instance.first.end_leaf(); ++leaf) {
+        source_words[i].push_back(leaf->GetWord());
+      }
+      for (const auto& node: instance.second) {
+        target_words[i].push_back(node.GetWord());
+      }
+    }
+
+    // Leaves all the sentences cached for the translation_probability
+    // benchmarks.
+    RunBenchmark(out, "cache_sentence", length, 0, min_time, [&]() {
+      for (int i = 0; i < num_sentences; ++i) {
+        forward_table->CacheSentence(source_words[i], target_words[i], i);
+      }
+      return (long long) num_sentences;
+    });
+
+    for (int fragment_size: vm["fragment-sizes"].as<vector<int>>()) {
+      cerr << "Running benchmarks for sentence length " << length
+           << " and fragment size " << fragment_size << "..." << endl;
+
+      vector<Instance> instances = ghkm_instances;
+      vector<vector<NodeIter>> split_nodes(num_sentences);
+      vector<vector<Rule>> sentence_rules(num_sentences);
+      vector<Rule> rules;
+      for (int i = 0; i < num_sentences; ++i) {
+        AlignedTree& tree = instances[i].first;
+        MergeFragments(tree, tree.begin(), fragment_size);
+        for (auto node = tree.begin(); node != tree.end(); ++node) {
+          if (node->IsSplitNode()) {
+            split_nodes[i].push_back(node);
+            sentence_rules[i].push_back(
+                extractor.ExtractRule(instances[i], node));
+            rules.push_back(sentence_rules[i].back());
+          }
+        }
+      }
+
+      RunBenchmark(out, "get_fragment", length, fragment_size, min_time,
+                   [&]() {
+        long long operations = 0;
+        for (int i = 0; i < num_sentences; ++i) {
+          for (const auto& node: split_nodes[i]) {
+            sink += instances[i].first.GetFragment(node).size();
+          }
+          operations += split_nodes[i].size();
+        }
+        return operations;
+      });
+
+      RunBenchmark(out, "extract_rule", length, fragment_size, min_time,
+                   [&]() {
+        for (int i = 0; i < num_sentences; ++i) {
+          for (const auto& node: split_nodes[i]) {
+            sink += extractor.ExtractRule(instances[i], node).second.size();
+          }
+        }
+        return (long long) rules.size();
+      });
+
+      RunBenchmark(out, "legal_spans", length, fragment_size, min_time,
+                   [&]() {
+        long long operations = 0;
+        for (const Instance& instance: instances) {
+          const AlignedTree& tree = instance.first;
+          for (auto node = ++tree.begin(); node != tree.end(); ++node) {
+            auto ancestor = tree.GetSplitAncestor(node);
+            sink += tree.GetLegalSpans(node, ancestor).size();
+            ++operations;
+          }
+        }
+        return operations;
+      });
+
+      map<int, RestaurantProcess<Rule>> restaurants;
+      for (const Rule& rule: rules) {
+        int root_tag = rule.first.GetRootTag();
+        if (!restaurants.count(root_tag)) {
+          restaurants[root_tag] = RestaurantProcess<Rule>(1.0);
+        }
+        restaurants[root_tag].Update(rule, 1);
+      }
+
+      RunBenchmark(out, "restaurant_log_probability", length, fragment_size,
+                   min_time, [&]() {
+        for (const Rule& rule: rules) {
+          sink += restaurants[rule.first.GetRootTag()].GetLogProbability(
+              rule, -10);
+        }
+        return (long long) rules.size();
+      });
+
+      RunBenchmark(out, "restaurant_update", length, fragment_size, min_time,
+                   [&]() {
+        for (const Rule& rule: rules) {
+          auto& restaurant = restaurants[rule.first.GetRootTag()];
+          restaurant.Update(rule, -1);
+          restaurant.Update(rule, 1);
+        }
+        return 2 * (long long) rules.size();
+      });
+
+      // Word indexes into the cached sentences, as used by the sampler.
+      vector<vector<pair<vector<int>, vector<int>>>> rule_items(num_sentences);
+      for (int i = 0; i < num_sentences; ++i) {
+        for (const Rule& rule: sentence_rules[i]) {
+          const AlignedTree& frag = rule.first;
+          vector<int> source_items, target_items;
+          for (auto leaf = frag.begin_leaf(); leaf != frag.end_leaf(); ++leaf) {
+            if (leaf->IsSetWord() &&
+                (!leaf->IsSplitNode() || leaf == frag.begin())) {
+              source_items.push_back(leaf->GetWordIndex());
+            }
+          }
+          for (const auto& node: rule.second) {
+            if (node.IsSetWord()) {
+              target_items.push_back(node.GetWordIndex());
+            }
+          }
+          rule_items[i].push_back(make_pair(source_items, target_items));
+        }
+      }
+
+      RunBenchmark(out, "translation_probability", length, fragment_size,
+                   min_time, [&]() {
+        for (int i = 0; i < num_sentences; ++i) {
+          for (const auto& items: rule_items[i]) {
+            sink += forward_table->ComputeAverageLogProbability(
+                items.first, items.second, i);
+          }
+        }
+        return (long long) rules.size();
+      });
+
+      vector<Alignment> rule_alignments;
+      for (const Rule& rule: rules) {
+        rule_alignments.push_back(
+            alignment_constructor.ConstructAlignments(rule).first);
+      }
+
+      RunBenchmark(out, "rule_reorderer", length, fragment_size, min_time,
+                   [&]() {
+        for (size_t i = 0; i < rules.size(); ++i) {
+          sink += rule_reorderer.Reorder(
+              rules[i].first, rule_alignments[i]).size();
+        }
+        return (long long) rules.size();
+      });
+
+      WriteGrammar(rules, dictionary, alignment_constructor,
+                   grammar_file, alignment_file);
+      ifstream grammar_stream(grammar_file);
+      ifstream alignment_stream(alignment_file);
+      Grammar grammar(grammar_stream, alignment_stream, dictionary, 0.1, 0,
+                      5, 8);
+
+      RunBenchmark(out, "rule_matcher", length, fragment_size, min_time,
+                   [&]() {
+        for (const Instance& instance: instances) {
+          RuleMatcher matcher(grammar, IndexedTree(instance.first));
+          sink += matcher.GetRules(0).size();
+        }
+        return (long long) instances.size();
+      });
+
+      // Reorders the source trees with the grammar extracted from them, so
+      // that most nodes have several matching rules.
+      auto reporter = make_shared<RuleStatsReporter>();
+      RunBenchmark(out, "reorder", length, fragment_size, min_time, [&]() {
+        for (const Instance& instance: instances) {
+          ViterbiReorderer reorderer(instance.first, grammar, reporter);
+          sink += reorderer.ConstructReordering().size();
+        }
+        return (long long) instances.size();
+      });
+    }
+
+    cerr << "Sentence length " << length << " done..." << endl;
+  }
+
+  fs::remove_all(temp_directory);
+  cerr << "Checksum: " << sink << endl;
+
+  return 0;
+}